@@ -0,0 +1,31 @@
+/*
+  Antipodal carriers packed as bits.
+
+  Sample j of carrier i is +1 if the bit k = i * N_s + j of alea is set and
+  -1 otherwise, bit k being bit k % 32 of alea[k / 32] (see projectSubspace).
+  The bits are expanded into sign masks instead of being tested one by one,
+  and each sum is made in the same order as the plain loops, so that the
+  results are identical.
+*/
+
+#ifndef _BOWS2_ANTIPODAL_H_
+#define _BOWS2_ANTIPODAL_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  /* v[i] += sum_j (+/-1) s[j] for the N_v carriers of N_s samples.
+     Several carriers are correlated per pass over s.                  */
+  void antipodal_project (const double *s, int N_s,
+			  unsigned int const *alea, double *v, int N_v);
+
+  /* s[j] += sum_i (+/-1) v[i]; each s[j] is written once.             */
+  void antipodal_embed (const double *v, int N_v, unsigned int const *alea,
+			double *s, int N_s);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
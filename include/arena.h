@@ -0,0 +1,89 @@
+/*
+   libit - Library for basic source and channel coding functions
+   Copyright (C) 2005-2005 Vivien Chappelier, Herve Jegou
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/*
+  Arenas of vectors and matrices
+  Copyright (C) 2005 Vivien Chappelier, Herve Jegou
+*/
+
+#ifndef __it_arena_h
+#define __it_arena_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* An arena hands out the memory of the vectors and matrices created by
+   the thread that uses it (it_arena_use), by bumping a pointer in large
+   chunks. The vectors it holds have no memory of their own (a NULL ptr
+   in their header): Vec_delete and Mat_delete do nothing on them and a
+   vector that grows is copied, as for the rows of a matrix. Everything
+   is released at once by it_arena_reset, which keeps the memory for the
+   next job: once the chunks are merged into one large enough, a job
+   makes no call to malloc at all.
+   A vector or matrix that must survive the reset (an object kept from
+   one job to the next) is created with no arena in use.                 */
+typedef struct _it_arena_chunk_ {
+  struct _it_arena_chunk_ *next;
+  size_t size;                   /* bytes available after the chunk header */
+} it_arena_chunk_t;
+
+typedef struct _it_arena_stats_ {
+  unsigned long allocs;          /* allocations since the last reset */
+  unsigned long resets;          /* resets so far */
+  unsigned long chunks;          /* chunks currently held */
+  size_t used;                   /* bytes handed out since the last reset */
+  size_t peak;                   /* largest value of used so far */
+  size_t reserved;               /* bytes of the chunks currently held */
+} it_arena_stats_t;
+
+typedef struct _it_arena_ {
+  it_arena_chunk_t *chunks;      /* chunk in use first */
+  char *top;                     /* next free byte of the chunk in use */
+  char *end;                     /* end of the chunk in use */
+  size_t chunk_size;             /* size of the chunks allocated on demand */
+  it_arena_stats_t stats;
+} it_arena_t;
+
+/* an arena whose chunks are of chunk_size bytes at least */
+it_arena_t *it_arena_new(size_t chunk_size);
+void it_arena_delete(it_arena_t *arena);
+
+/* Release everything allocated in the arena. The chunks are kept, merged
+   into a single one holding them all when there are several.            */
+void it_arena_reset(it_arena_t *arena);
+
+/* Make arena the one of the calling thread (NULL for malloc) and return
+   the previous one. The other threads, including the workers of the
+   thread pool, are not affected.                                         */
+it_arena_t *it_arena_use(it_arena_t *arena);
+it_arena_t *it_arena_current(void);
+
+/* size bytes aligned on a double from the arena of the calling thread,
+   NULL if it has none                                                    */
+void *it_arena_alloc(size_t size);
+
+#define it_arena_stats(arena) ((arena)->stats)
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,85 @@
+/*
+  Vector kernels of the level 1 operations on vectors of doubles.
+
+  The kernels are written for SSE2, AVX and AVX-512 and the widest one
+  supported by the processor is selected on first use, as for the
+  lifting kernels. The element-wise operations give the same results
+  whatever the instruction set.
+
+  The reductions have two modes:
+    BLAS_ORDERED  the terms are added one by one in the order of the
+                  samples, as the plain loops of vec.c always did. The
+                  results are those of the previous versions, and of the
+                  code that repeats these loops (the carriers generated
+                  on the fly, vec_inner_product_many).
+    BLAS_BLOCKED  the terms of the samples j = k mod BLAS_LANES are added
+                  in the partial sum k, the BLAS_LANES sums are then
+                  added by halves (k and k + BLAS_LANES / 2 first), and
+                  the last n % BLAS_LANES terms one by one. Several sums
+                  are in flight at once, hence the speed, but the results
+                  differ from BLAS_ORDERED in the last bits. They are
+                  identical for all the instruction sets and thread counts,
+                  no multiply-add being fused.
+  The mode is global; BLAS_ORDERED is the default.
+*/
+
+#ifndef _BOWS2_BLAS_H_
+#define _BOWS2_BLAS_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* instruction sets of the kernels */
+#define BLAS_C      0
+#define BLAS_SSE2   1
+#define BLAS_AVX    2
+#define BLAS_AVX512 3
+
+/* modes of the reductions */
+#define BLAS_ORDERED 0
+#define BLAS_BLOCKED 1
+
+/* partial sums of the blocked reductions */
+#define BLAS_LANES 16
+
+  /* Selects the kernels of instruction set isa, or of the widest one the
+     processor supports below it; returns the set actually selected.     */
+  int blas_set_isa (int isa);
+  int blas_isa (void);
+
+  void blas_set_mode (int mode);
+  int blas_mode (void);
+
+  /* x[j] += y[j], x[j] -= y[j], x[j] *= a and x[j] /= a for j < n */
+  void blas_add (double *x, const double *y, int n);
+  void blas_sub (double *x, const double *y, int n);
+  void blas_scale (double *x, double a, int n);
+  void blas_div (double *x, double a, int n);
+
+  /* y[j] += a x[j] and y[j] = a x[j] + b y[j] for j < n */
+  void blas_axpy (double *y, double a, const double *x, int n);
+  void blas_axpby (double *y, double a, const double *x, double b,
+		   int n);
+
+  /* sums of x[j] y[j], x[j], |x[j]| and x[j]^2 for j < n */
+  double blas_dot (const double *x, const double *y, int n);
+  double blas_sum (const double *x, int n);
+  double blas_asum (const double *x, int n);
+  double blas_sum_sqr (const double *x, int n);
+
+  /* y[j] += a x[j] for j < n, then the sum of y[j] z[j] with the new
+     values of y, in the same pass; z may be y.                        */
+  double blas_axpy_dot (double *y, double a, const double *x,
+			const double *z, int n);
+
+  /* Prints the time per sample of the kernels on vectors of n samples,
+     each one being run repeat times, for every instruction set the
+     processor supports and both modes of the reductions.              */
+  void blas_benchmark (int n, int repeat);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
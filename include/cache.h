@@ -0,0 +1,79 @@
+/*
+  On-disk carrier cache.
+
+  A cache file holds the nb_bits carriers of one layer, as drawn for a
+  given key by a given generator. It is written once, then mapped
+  read-only by the following runs: the carriers are used in place, the
+  pages being shared by all the processes that map the same file.
+
+  Layout (native byte order, 64-byte blocks):
+    header       magic, format version, generator, key, layer, dim,
+                 nb_bits, sizeof (Vec_header_t), record size, element
+                 type and size
+    records      for each carrier, one block ending with the image of
+                 its vector header, then its dim samples padded to a
+                 whole block. A carrier in double is thus a regular
+                 (read-only) vec. The samples of the compact types are
+                 stored as they are (4 or 1 byte), the step of a QIM_I8
+                 carrier at the start of its first block.
+  The element type is the one of the generator (CACHE_GEN_TYPE).
+
+  A file that does not match all of the parameters is ignored, and
+  overwritten by carrier_cache_write. The carriers of a cache stay
+  mapped until carrier_cache_close.
+*/
+
+#ifndef _BOWS2_CACHE_H_
+#define _BOWS2_CACHE_H_
+
+#include "../include/vec.h"
+#include "../include/qim.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* format of the cache files */
+#define CACHE_VERSION 2
+
+/* generators of the carriers; bump when the way carriers are drawn changes */
+#define CACHE_GEN_MT19937 1	/* vec_randn then vec_normalize, MT19937     */
+#define CACHE_GEN_ORTHO   0x100	/* flag: then qim_orthonormalize            */
+#define CACHE_GEN_TYPE(t) ((t) << 12)	/* then qim_pack to type t      */
+#define CACHE_GEN_TYPE_OF(g) (((g) >> 12) & 0xf)
+
+  typedef struct _carrier_cache_
+  {
+    vec *carriers;		/* nb_bits read-only carriers of length dim */
+    qim_packed_t *packed;	/* or the same in a compact type; owned by
+				   the cache, not for qim_packed_delete     */
+    int type;
+    int nb_bits;
+    int dim;
+    void *base;			/* file mapping, or buffer                  */
+    size_t size;
+    int mapped;
+  } carrier_cache_t;
+
+  /* Carriers of the cache file of dir matching all the parameters,
+     NULL if there is none. They are in carriers for QIM_F64, in packed
+     otherwise.                                                       */
+  carrier_cache_t *carrier_cache_open (const char *dir,
+				       unsigned int const key[4], int layer,
+				       int dim, int nb_bits,
+				       unsigned int generator);
+  void carrier_cache_close (carrier_cache_t * cache);
+
+  /* Writes the carriers in the cache file of dir; returns 0 on failure */
+  int carrier_cache_write (const char *dir, unsigned int const key[4],
+			   int layer, int dim, int nb_bits,
+			   unsigned int generator, vec * carriers);
+  int carrier_cache_write_packed (const char *dir, unsigned int const key[4],
+				  int layer, unsigned int generator,
+				  qim_packed_t * p);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -43,15 +43,33 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "../include/vec.h"
 #include "../include/mat.h"
+#include "../include/wavelet.h"
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+  /* Copies the coefficients of the subbands of the levels of WavX in V_X,
+     subband after subband from the finest level, and those of LL in
+     VcoreX; either vector may be NULL. extractInv writes them back in
+     WavY, a subband whose vector is NULL being left as it is.           */
   int extract (mat WavX, vec VcoreX, vec V_X, int levels);
   int extractInv (vec VcoreX, vec V_X, int levels, int hI, int wI, mat WavY);
 
+  /* Same thing on a block of the coefficients (its LL quadrant for the
+     next levels), read and written in place.                            */
+  int extract_view (mat_view WavX, vec VcoreX, vec V_X, int levels);
+  int extractInv_view (vec VcoreX, vec V_X, int levels, mat_view WavY);
+
+  /* Subbands of the first level of a pgm image, as V_X with levels = 1,
+     the image being read and transformed line by line (it is never held
+     in memory). Returns a new vector and the size of the image, or NULL
+     if the file cannot be read.                                         */
+  vec extract_pgm_HF (const char *filename,
+		      it_wavelet_lifting_t const *lifting,
+		      int *width, int *height);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,6 +25,7 @@
 #ifndef __it_io_h
 #define __it_io_h
 
+#include <stdio.h>
 #include <stdarg.h>
 #include <assert.h>
 #include "../include/mat.h"
@@ -113,6 +114,16 @@ int mat_pgm_write( const char* filename, mat m );
 /* Write a matrix of integers as a pgm file                             */
 int imat_pgm_write( const char* filename, imat m );
 
+/* Read a pgm file line by line: open it and get its size, then read
+   its lines one after the other in a vector of its width.
+   The file is closed with fclose.                                      */
+FILE * pgm_read_open( const char* filename, int * p_width, int * p_height );
+int vec_pgm_read_line( FILE * F, vec v );
+
+/* Write a pgm file of the given size line by line                      */
+FILE * pgm_write_open( const char* filename, int width, int height );
+int vec_pgm_write_line( FILE * F, vec v );
+
 /*----------------------------------------------------------------------*/
 /* WAV file handling functions                                          */
 int wav_info( const char * filename, int * p_channels, int *p_srate, int *p_depth, int *p_length);
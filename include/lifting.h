@@ -0,0 +1,66 @@
+/*
+  Vector kernels of the lifting wavelet transforms.
+
+  A lifting step updates n samples at once, d[j] = s[j] + c (a[j] + b[j]),
+  the four arrays being rows of the image for the vertical pass, or the
+  same line shifted by one sample for the horizontal one. The kernels are
+  written for SSE2, AVX and AVX-512 and the widest one supported by the
+  processor is selected on first use. Every sample is computed with the
+  same operations in the same order as the plain C loop (no fused
+  multiply-add), so that all of them give identical coefficients.
+  The single precision and integer kernels have twice as many lanes.
+*/
+
+#ifndef _BOWS2_LIFTING_H_
+#define _BOWS2_LIFTING_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* instruction sets of the kernels */
+#define LIFTING_C      0
+#define LIFTING_SSE2   1
+#define LIFTING_AVX    2
+#define LIFTING_AVX512 3
+
+  /* Selects the kernels of instruction set isa, or of the widest one the
+     processor supports below it; returns the set actually selected.     */
+  int lifting_set_isa (int isa);
+  int lifting_isa (void);
+
+  /* d[j] = s[j] + c (a[j] + b[j]) for j < n; d may be s */
+  void lifting_step (double *d, const double *s, const double *a,
+		     const double *b, double c, int n);
+
+  /* d[j] *= c for j < n */
+  void lifting_scale (double *d, double c, int n);
+
+  /* even[j] = x[2j], odd[j] = x[2j+1] for the n samples of x, and back */
+  void lifting_split (double *even, double *odd, const double *x, int n);
+  void lifting_merge (double *x, const double *even, const double *odd,
+		      int n);
+
+  /* the same in single precision, with twice as many lanes */
+  void lifting_fstep (float *d, const float *s, const float *a,
+		      const float *b, float c, int n);
+  void lifting_fscale (float *d, float c, int n);
+  void lifting_fsplit (float *even, float *odd, const float *x, int n);
+  void lifting_fmerge (float *x, const float *even, const float *odd,
+		       int n);
+
+  /* d[j] = s[j] + sign ((a[j] + b[j] + add) >> shift) for j < n, sign
+     being 1 or -1: the steps of the reversible 5/3, on integers. The
+     shift rounds down, also for negative sums.                      */
+  void lifting_istep (int *d, const int *s, const int *a, const int *b,
+		      int add, int shift, int sign, int n);
+
+  /* lifting_split and lifting_merge on integers */
+  void lifting_isplit (int *even, int *odd, const int *x, int n);
+  void lifting_imerge (int *x, const int *even, const int *odd, int n);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
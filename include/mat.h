@@ -78,12 +78,37 @@ static inline Mat __Mat_new_alloc(size_t elem_size, idx_t h, idx_t w, idx_t hmax
   return(m);
 }
 
-/* Allocate a matrix. This function do not return the matrix pointer.
+/* Allocate a matrix in a single block, after the vector of its rows: each
+   row starts on an IT_MAT_ALIGN boundary, its header lying in the padding
+   of the previous row, so that the rows are Mat_slab_stride bytes apart.
+   The block belongs to the vector of the rows and the rows have no memory
+   of their own (a NULL ptr in their header, Vec_delete doing nothing):
+   Mat_delete frees the whole matrix, and a row that grows is copied.    */
+#define IT_MAT_ALIGN 64
+#define Mat_slab_stride( elem_size, w ) \
+  (((elem_size) * (w) + sizeof(Vec_header_t) + IT_MAT_ALIGN - 1) & ~((size_t) IT_MAT_ALIGN - 1))
+
+#define Mat_new_slab( type_t, h, w ) ((type_t **) __Mat_new_slab( sizeof(type_t), h, w ))
+Mat __Mat_new_slab(size_t elem_size, idx_t h, idx_t w);
+
+/* Give their own memory to the rows that have none, before the block of
+   the vector of the rows is reallocated                                        */
+static inline void __Mat_own_rows(Mat m)
+{
+  idx_t i;
+
+  for( i = 0 ; i < Mat_height_max(m) ; i++ )
+    if( !Vec_header(m[i]).ptr )
+      m[i] = __Vec_new_realloc( m[i], Vec_element_size(m[i]),
+				Vec_length(m[i]), Vec_length_max(m[i]) );
+}
+
+/* Allocate a matrix (in a single block). This function do not return the matrix pointer.
    For this purpose, use specialized matrix instead                             */
 #define Mat_new( type_t, h, w ) ((type_t **) __Mat_new( sizeof(type_t), h, w ))
 static inline Mat __Mat_new( size_t elem_size, idx_t h, idx_t w)
 {
-  return(__Mat_new_alloc(elem_size, h, w, h, w));
+  return(__Mat_new_slab(elem_size, h, w));
 }
 
 /* Free the vector                                                              */
@@ -110,6 +135,7 @@ static inline void __Mat_delete(Mat m)
     idx_t i, oldhmax = Mat_height_max(m);                                     \
     assert( hmax >= Vec_length(m) );                                          \
     if( hmax > Mat_height(m) ) {                                              \
+      __Mat_own_rows( (Mat) (m) );                                            \
       Vec_set_length_max(m,hmax);                                             \
       for( i = oldhmax ; i < hmax ; i++ ) {                                   \
         void ** pm = (void **) &(m)[i]; /* keep both C/C++ compilers happy */ \
@@ -425,6 +451,10 @@ void cmat_elem_div( cmat m1, cmat m2 );
 void mat_add( mat m1, mat m2 );      
 void mat_sub( mat m1, mat m2 );
 
+/* m1 += a m2 and m1 = a m2 + b m1, in one pass (see vec_axpy)          */
+void mat_axpy( mat m1, double a, mat m2 );
+void mat_axpby( mat m1, double a, mat m2, double b );
+
 mat  mat_new_add( mat m1, mat m2 );      
 mat  mat_new_sub( mat m1, mat m2 );
 mat  mat_new_mul( mat m1, mat m2 );
@@ -502,6 +532,49 @@ mat  mat_set_submatrix( mat m, mat s, idx_t r, idx_t c );
 imat imat_set_submatrix( imat m, imat s, idx_t r, idx_t c );
 bmat bmat_set_submatrix( bmat m, bmat s, idx_t r, idx_t c );
 
+/* View of a block of a matrix of doubles, in place (see vec_view): the
+   rows are width samples long and stride samples apart. The matrix must
+   be in a single block (Mat_new), its rows being equally spaced; a view
+   of a view is a view of the same matrix.                                */
+typedef struct _mat_view_ {
+  double *data;                  /* first sample of the first row */
+  idx_t height, width;
+  idx_t stride;                  /* distance between two rows */
+} mat_view;
+
+mat_view mat_get_submatrix_view( mat m, idx_t r1, idx_t c1, idx_t r2, idx_t c2 );
+mat_view mat_view_get_submatrix( mat_view s, idx_t r1, idx_t c1, idx_t r2, idx_t c2 );
+#define mat_get_view( m ) mat_get_submatrix_view( m, 0, 0, end, end )
+
+#define _mat_view( s, r, c ) ((s).data[(r) * (s).stride + (c)])
+
+static inline vec_view mat_view_row( mat_view s, idx_t r ) {
+  vec_view v;
+  assert( r >= 0 && r < s.height );
+  v.data = s.data + r * s.stride;
+  v.length = s.width;
+  v.stride = 1;
+  return v;
+}
+
+static inline vec_view mat_view_col( mat_view s, idx_t c ) {
+  vec_view v;
+  assert( c >= 0 && c < s.width );
+  v.data = s.data + c;
+  v.length = s.height;
+  v.stride = s.stride;
+  return v;
+}
+
+/* copy the samples of the view, row after row, in v from the index idx
+   (or the other way round) and return the index following the last one */
+idx_t mat_view_to_vec( mat_view s, vec v, idx_t idx );
+idx_t vec_to_mat_view( vec v, idx_t idx, mat_view s );
+void mat_view_copy( mat_view dst, mat_view src );
+void mat_view_mul_by( mat_view s, double a );
+/* y += a x */
+void mat_view_axpy( mat_view y, double a, mat_view x );
+
 static inline vec mat_copy_row( vec v, mat m, idx_t r) {
   assert(m);
   MAT_END_ROW_PARAM( m, r );
@@ -0,0 +1,32 @@
+/*
+  Pool of worker threads.
+
+  pool_run executes the tasks 0..n_tasks-1 of a parallel loop. The tasks
+  are first split into one contiguous range per thread; a thread whose
+  range is exhausted steals tasks from the end of the others. Nothing is
+  shared between tasks by the pool itself: a loop gives the same result
+  whatever the number of threads as long as each task writes its own
+  outputs and the partial results are combined in task order afterwards.
+*/
+
+#ifndef _BOWS2_POOL_H_
+#define _BOWS2_POOL_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  /* number of threads used by pool_run, the calling one included.
+     0 selects one thread per online core, 1 runs the loops inline.   */
+  void pool_set_threads (int nthreads);
+  int pool_threads (void);
+
+  /* fn (arg, t) for t = 0..n_tasks-1, returns once all of them are done.
+     A pool_run called from inside a task runs its tasks inline.          */
+  void pool_run (int n_tasks, void (*fn) (void *arg, int task), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,104 @@
+/*
+  Scalar QIM on secret Gaussian carriers.
+
+  A bit is carried by the parity of the cell floor(<x, c> / pas) in which
+  the projection of the host vector x on the normalized carrier c falls.
+  Embedding moves the projection to the center of the nearest cell of
+  the right parity.
+*/
+
+#ifndef _BOWS2_QIM_H_
+#define _BOWS2_QIM_H_
+
+#include "../include/vec.h"
+#include "../include/mat.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* number of carrier samples generated at once by the streaming engine */
+#define QIM_BLOCK 4096
+
+/* number of samples of every carrier drawn at once by batched detection */
+#define QIM_TILE 256
+
+  /* bit coded by a projection, and displacement that makes it code bit */
+  int qim_bit (double produit, double pas);
+  double qim_displacement (double produit, double pas, int bit);
+
+  /* embedding / detection with carriers stored in memory */
+  int qim_embed (vec V_X, vec * carriers, int *mot, int nb_bits, double pas);
+  int qim_detect (vec V_X, vec * carriers, int *mot, int nb_bits,
+		  double pas);
+
+  /* Joint embedding: the displacements of all the bits are solved at once
+     through the Gram matrix of the carriers (Cholesky), so that every
+     projection ends exactly at the center of its cell.                 */
+  int qim_embed_joint (vec V_X, vec * carriers, int *mot, int nb_bits,
+		       double pas);
+
+  /* Orthonormalizes the stored carriers in place, so that the bits do
+     not interfere. Detection must use carriers orthonormalized the same
+     way.                                                              */
+  int qim_orthonormalize (vec * carriers, int nb_bits);
+
+/* element types of stored carriers */
+#define QIM_F64 0		/* double                               */
+#define QIM_F32 1		/* float                                */
+#define QIM_I8  2		/* signed char times a per-carrier step */
+
+  /* Stored carriers in a compact type, for detection */
+  typedef struct _qim_packed_
+  {
+    int type;			/* QIM_F32 or QIM_I8                  */
+    int nb_bits;
+    int dim;
+    void **data;		/* nb_bits arrays of dim samples      */
+    double *scale;		/* step of the QIM_I8 samples         */
+  } qim_packed_t;
+
+  qim_packed_t *qim_pack (vec * carriers, int nb_bits, int type);
+  void qim_packed_delete (qim_packed_t * p);
+
+  /* The carriers drawn as by vec_randn then vec_normalize (MT19937) and
+     packed: the same as qim_pack on all of them. They are drawn and
+     packed one at a time, never being held in double all at once, unless
+     ortho is set: they are then orthonormalized by qim_orthonormalize
+     before being packed.                                              */
+  qim_packed_t *qim_packed_randn (int nb_bits, int dim, int type,
+				  int ortho);
+
+  /* Same as qim_embed, qim_embed_joint and qim_detect on the carriers
+     converted back to double; the products are summed in double      */
+  int qim_embed_packed (vec V_X, qim_packed_t * p, int *mot, double pas);
+  int qim_embed_joint_packed (vec V_X, qim_packed_t * p, int *mot,
+			      double pas);
+  int qim_detect_packed (vec V_X, qim_packed_t * p, int *mot, double pas);
+
+  /* Embedding / detection with carriers drawn from the MT19937 generator
+     (which must be seeded by the caller) and regenerated instead of being
+     stored: one group of QIM_GROUP (8) carriers is held at a time, whatever
+     nb_bits. The generator is left in the same state, and the carriers are
+     those drawn with vec_randn/vec_normalize. The projections are summed
+     in another order than on stored carriers, so they may differ from
+     them in the last bits.                                             */
+  int qim_embed_stream (vec V_X, int *mot, int nb_bits, double pas);
+  int qim_detect_stream (vec V_X, int *mot, int nb_bits, double pas);
+
+  /* Carriers drawn from the counter-based generator keyed by key[4]
+     (carrier i is the stream i, see it_keyed_randn). The carriers are
+     not stored and each one can be drawn independently of the others.
+     Not compatible with the marks made with the MT19937 carriers.   */
+  int qim_embed_keyed (vec V_X, unsigned int const key[4], int *mot,
+		       int nb_bits, double pas);
+  int qim_embed_keyed_joint (vec V_X, unsigned int const key[4], int *mot,
+			     int nb_bits, double pas);
+  int qim_detect_keyed (vec V_X, unsigned int const key[4], int *mot,
+			int nb_bits, double pas);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -67,7 +67,8 @@ extern "C" {
 #endif
 
 /* MT19937cok-ar related functions: they are here for providing   */ 
-/* additional features to whoever might need it                   */
+/* additional features to whoever might need it. The generator is  */
+/* per thread: a thread draws from the sequence it has seeded.     */
 void mt19937_srand(unsigned int seed); 
 void mt19937_srand_by_array(unsigned int init_key[], unsigned int key_length);
 /* generates a random number on [0,0xffffffff]-interval */
@@ -83,6 +84,26 @@ double mt19937_rand_real3(void);
 /* generates a random number on [0,1) with 53-bit resolution*/
 double mt19937_rand_res53(void);
 
+/* snapshot of the MT19937 generator, used to replay a stretch of the */
+/* sequence (e.g. to regenerate a carrier instead of storing it)      */
+typedef struct _mt19937_state_ {
+  unsigned int state[624];
+  int left;
+  int initf;
+  int next;                      /* offset of the next word in state */
+} mt19937_state_t;
+
+void mt19937_get_state(mt19937_state_t *s);
+void mt19937_set_state(mt19937_state_t const *s);
+
+/* buf[k] for k < n: the next n values of it_randn from the state s,  */
+/* which is moved past them. The generator of the thread is not       */
+/* touched, so the snapshots of a thread may be replayed by others.   */
+void mt19937_randn_fill(mt19937_state_t *s, double *buf, int n);
+/* move the generator past the next n values of it_randn, faster      */
+/* than drawing them                                                  */
+void mt19937_randn_skip(int n);
+
 
 /* initialize the random number generator (with a random seed)    */
 /* Note: the seed is taken from the milliseconds of the current   */
@@ -110,6 +131,28 @@ double it_randpdf(double a, double b, it_function_t pdf, it_args_t args);
 /* Random variable that follows a memoryless pdf */
 int it_rand_memoryless( vec pdf );
 
+
+/* Counter-based generator (Threefry-4x32-20, Salmon et al., SC'11).  */
+/* The output is a pure function of a 128-bit key and of a 128-bit   */
+/* counter: the samples of a stream can be drawn in any order, from   */
+/* any thread, without sharing a state.                               */
+void it_threefry4x32(unsigned int const key[4], unsigned int const ctr[4],
+		     unsigned int out[4]);
+
+/* Keyed streams: sample 'sample' of the stream 'stream' (e.g. the    */
+/* index of a carrier) drawn from the generator keyed by key[4].      */
+unsigned int it_keyed_rand_int32(unsigned int const key[4], 
+				 unsigned int stream, unsigned int sample);
+/* uniform in [0,1) */
+double it_keyed_rand(unsigned int const key[4], 
+		     unsigned int stream, unsigned int sample);
+/* N(0,1), same ziggurat as it_randn */
+double it_keyed_randn(unsigned int const key[4], 
+		      unsigned int stream, unsigned int sample);
+/* buf[k] = it_keyed_randn(key, stream, first + k) for k < n */
+void it_keyed_randn_fill(unsigned int const key[4], unsigned int stream,
+			 unsigned int first, double *buf, int n);
+
 #ifdef __cplusplus
 }
 #endif /* extern "C" */
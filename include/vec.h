@@ -140,7 +140,18 @@ extern cvec const cvec_null;
 */
 #define IT_ALLOC_ALIGN (sizeof(double))
 
-/* Vector allocation functions */
+/* Number of blocks allocated so far by libit and their total size in
+   bytes: vectors, matrices, arena chunks, the plans, streams and band
+   tables of the transforms, and the text buffers of io and parser. They
+   allow to check that a loop allocates nothing. Vec_alloc_account updates
+   them atomically; every malloc of libit outside of vectors calls it.  */
+extern unsigned long Vec_alloc_count;
+extern size_t Vec_alloc_bytes;
+
+void Vec_alloc_account(size_t bytes);
+
+/* Vector allocation functions. The memory comes from the arena of the
+   calling thread when it has one (see arena.h), from malloc otherwise.     */
 Vec __Vec_new_alloc(size_t elem_size, idx_t length, idx_t length_max);
 Vec __Vec_new_realloc(void *V, size_t elem_size, idx_t length, idx_t length_max);
 
@@ -360,6 +371,39 @@ static inline ivec ivec_set_subvector( ivec v, ivec s, idx_t idx ) { VEC_END_PAR
 static inline bvec bvec_set_subvector( bvec v, bvec s, idx_t idx ) { VEC_END_PARAM( v, idx ); Vec_set_subvector( v, s, idx ); return v; }
 static inline cvec cvec_set_subvector( cvec v, cvec s, idx_t idx ) { VEC_END_PARAM( v, idx ); Vec_set_subvector( v, s, idx ); return v; }
 
+/* Views: samples of doubles lying in the memory of a vector or a matrix,
+   stride samples apart. A view has no header and owns nothing: it is a
+   small structure passed by value, valid as long as the memory it looks
+   at. Unlike vec_get_subvector, vec_get_subvector_view copies nothing.  */
+typedef struct _vec_view_ {
+  double *data;                  /* first sample */
+  idx_t length;
+  idx_t stride;                  /* distance between two samples */
+} vec_view;
+
+static inline vec_view vec_get_subvector_view( vec v, idx_t i1, idx_t i2 )
+{
+  vec_view s;
+  VEC_END_PARAM( v, i1 );
+  VEC_END_PARAM( v, i2 );
+  assert( i1 >= 0 && i2 < vec_length( v ) && i1 <= i2 + 1 );
+  s.data = v + i1;
+  s.length = i2 - i1 + 1;
+  s.stride = 1;
+  return s;
+}
+
+#define _vec_view( s, i ) ((s).data[(i) * (s).stride])
+
+/* copy the samples of the view in v from the index idx (or the other way
+   round) and return the index following the last sample copied           */
+idx_t vec_view_to_vec( vec_view s, vec v, idx_t idx );
+idx_t vec_to_vec_view( vec v, idx_t idx, vec_view s );
+void vec_view_copy( vec_view dst, vec_view src );
+void vec_view_mul_by( vec_view s, double a );
+/* y += a x */
+void vec_view_axpy( vec_view y, double a, vec_view x );
+
 /*------------------------------------------------------------------------------*/
 /*                Copy and Conversions Functions                                */
 /*------------------------------------------------------------------------------*/
@@ -479,6 +523,31 @@ void cvec_div( cvec v1, cvec v2 );
 double vec_inner_product( vec v1, vec v2 );   
 int ivec_inner_product( ivec v1, ivec v2 );   
 
+/* The inner products of v with the k vectors w[0..k-1], stored in p[0..k-1].
+   v is read once whatever k. Each p[i] is accumulated in the same order as
+   vec_inner_product( v, w[i] ) in the BLAS_ORDERED mode of the reductions
+   (see blas.h), hence the results are identical.                           */
+void vec_inner_product_many( vec v, vec * w, idx_t k, double * p );
+
+/* Same on the n first elements of raw arrays; the products are added to p  */
+void __vec_inner_product_many( const double * v, double ** w, idx_t k,
+			       idx_t n, double * p );
+
+/* v += a[0] * w[0] + ... + a[k-1] * w[k-1] in one pass over v. The terms are
+   added to each element in the order of i, as k successive updates would.   */
+void vec_add_many( vec v, vec * w, const double * a, idx_t k );
+void __vec_add_many( double * v, double ** w, const double * a, idx_t k,
+		     idx_t n );
+
+/* Fused operations, in one pass over the vectors and without temporary.
+   vec_axpy_dot takes the inner product with the updated y, so that a series
+   of steps "p = <y, z>, then y += f(p) x" costs one pass per step. The sums
+   follow the mode of the reductions (see blas.h).                           */
+void vec_axpy( vec y, double a, vec x );              /* y += a x             */
+void vec_axpby( vec y, double a, vec x, double b );   /* y = a x + b y        */
+double vec_axpy_dot( vec y, double a, vec x, vec z ); /* y += a x, <y, z>     */
+double vec_axpy_norm( vec y, double a, vec x );       /* y += a x, ||y||_2    */
+
 /* Common functions                                                             */
 void vec_neg( vec v );                  /* Negate the vector                    */
 void ivec_neg( ivec v );
@@ -0,0 +1,200 @@
+/*
+   libit - Library for basic source and channel coding functions
+   Copyright (C) 2005-2005 Vivien Chappelier, Herve Jegou
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/*
+  Expressions of vectors (C++ only)
+  Copyright (C) 2005 Vivien Chappelier, Herve Jegou
+*/
+
+#ifndef __it_vec_expr_h
+#define __it_vec_expr_h
+
+#ifdef __cplusplus
+
+#include <math.h>
+#include "../include/vec.h"
+#include "../include/blas.h"
+
+/* Element-wise expressions of vectors, evaluated in a single loop on the
+   storage of the vectors themselves, without temporary vector:
+
+     it::ref( y ) = a * it::ref( x ) + b * it::ref( y ) - it::ref( z );
+     it::ref( y ) += a * it::ref( x );
+     p = it::dot( it::ref( x ) - it::ref( y ), it::ref( w ) );
+
+   Each sample is computed with the operations written, in that order, so
+   that a * ref( x ) + b * ref( y ) gives the same values as vec_axpby; the
+   sums are made as blas_dot makes them in the current mode of the
+   reductions. Multiply-adds are assumed not to be fused, as with the
+   default flags on x86 (use -ffp-contract=off with -mfma).
+   The sample j of the result only depends on the samples j of the
+   operands, so an assigned vector may also appear in the expression.     */
+
+namespace it {
+
+template <class E> struct expr {
+  E const & self() const { return static_cast<E const &>( *this ); }
+};
+
+/* a vector in an expression */
+struct term : expr<term> {
+  double const * p;
+  idx_t n;
+
+  term( vec v ) : p( v ), n( vec_length( v ) ) {}
+  double operator[]( idx_t j ) const { return p[ j ]; }
+  idx_t length() const { return n; }
+};
+
+/* operations on two samples */
+struct add_op { static double apply( double a, double b ) { return a + b; } };
+struct sub_op { static double apply( double a, double b ) { return a - b; } };
+struct mul_op { static double apply( double a, double b ) { return a * b; } };
+struct div_op { static double apply( double a, double b ) { return a / b; } };
+
+/* a op b for two expressions, c op a and a op c with a scalar c */
+template <class A, class B, class Op> struct binary : expr<binary<A, B, Op> > {
+  A a;
+  B b;
+
+  binary( A const & a, B const & b ) : a( a ), b( b ) { assert( a.length() == b.length() ); }
+  double operator[]( idx_t j ) const { return Op::apply( a[ j ], b[ j ] ); }
+  idx_t length() const { return a.length(); }
+};
+
+template <class A, class Op> struct scalar_left : expr<scalar_left<A, Op> > {
+  double c;
+  A a;
+
+  scalar_left( double c, A const & a ) : c( c ), a( a ) {}
+  double operator[]( idx_t j ) const { return Op::apply( c, a[ j ] ); }
+  idx_t length() const { return a.length(); }
+};
+
+template <class A, class Op> struct scalar_right : expr<scalar_right<A, Op> > {
+  A a;
+  double c;
+
+  scalar_right( A const & a, double c ) : a( a ), c( c ) {}
+  double operator[]( idx_t j ) const { return Op::apply( a[ j ], c ); }
+  idx_t length() const { return a.length(); }
+};
+
+template <class A> struct negate : expr<negate<A> > {
+  A a;
+
+  negate( A const & a ) : a( a ) {}
+  double operator[]( idx_t j ) const { return -a[ j ]; }
+  idx_t length() const { return a.length(); }
+};
+
+#define __IT_VEC_EXPR_OPERATOR( op, Op )                                        \
+  template <class A, class B> inline binary<A, B, Op>                           \
+  operator op( expr<A> const & a, expr<B> const & b )                           \
+  { return binary<A, B, Op>( a.self(), b.self() ); }                            \
+  template <class A> inline scalar_left<A, Op>                                  \
+  operator op( double c, expr<A> const & a )                                    \
+  { return scalar_left<A, Op>( c, a.self() ); }                                 \
+  template <class A> inline scalar_right<A, Op>                                 \
+  operator op( expr<A> const & a, double c )                                    \
+  { return scalar_right<A, Op>( a.self(), c ); }
+
+__IT_VEC_EXPR_OPERATOR( +, add_op )
+__IT_VEC_EXPR_OPERATOR( -, sub_op )
+__IT_VEC_EXPR_OPERATOR( *, mul_op )
+__IT_VEC_EXPR_OPERATOR( /, div_op )
+
+#undef __IT_VEC_EXPR_OPERATOR
+
+template <class A> inline negate<A> operator-( expr<A> const & a )
+{
+  return negate<A>( a.self() );
+}
+
+/* a vector that can be assigned an expression */
+struct vec_ref : term {
+  vec v;
+
+  explicit vec_ref( vec v ) : term( v ), v( v ) {}
+
+  template <class E, class Op> vec_ref & update( E const & e, Op )
+  {
+    idx_t j;
+    assert( e.length() == n );
+    for( j = 0 ; j < n ; j++ )
+      v[ j ] = Op::apply( v[ j ], e[ j ] );
+    return *this;
+  }
+
+  template <class E> vec_ref & operator=( expr<E> const & e )
+  {
+    E const & x = e.self();
+    idx_t j;
+    assert( x.length() == n );
+    for( j = 0 ; j < n ; j++ )
+      v[ j ] = x[ j ];
+    return *this;
+  }
+  vec_ref & operator=( vec_ref const & r ) { return *this = static_cast<expr<term> const &>( r ); }
+
+  template <class E> vec_ref & operator+=( expr<E> const & e ) { return update( e.self(), add_op() ); }
+  template <class E> vec_ref & operator-=( expr<E> const & e ) { return update( e.self(), sub_op() ); }
+  template <class E> vec_ref & operator*=( expr<E> const & e ) { return update( e.self(), mul_op() ); }
+  vec_ref & operator*=( double c ) { blas_scale( v, c, n ); return *this; }
+  vec_ref & operator/=( double c ) { blas_div( v, c, n ); return *this; }
+};
+
+/* a function rather than a type: it::ref( y ) = ... would otherwise
+   declare a variable y                                                  */
+inline vec_ref ref( vec v ) { return vec_ref( v ); }
+
+/* sum of a[j] b[j], made as blas_dot makes it */
+template <class A, class B> inline double dot( expr<A> const & ea, expr<B> const & eb )
+{
+  A const & a = ea.self();
+  B const & b = eb.self();
+  idx_t j = 0, n = a.length();
+  double p = 0;
+  int h, k;
+
+  assert( n == b.length() );
+  if( blas_mode() == BLAS_BLOCKED ) {
+    double acc[ BLAS_LANES ] = { 0 };
+
+    for( ; j + BLAS_LANES <= n ; j += BLAS_LANES )
+      for( k = 0 ; k < BLAS_LANES ; k++ )
+	acc[ k ] += a[ j + k ] * b[ j + k ];
+    for( h = BLAS_LANES / 2 ; h > 0 ; h >>= 1 )
+      for( k = 0 ; k < h ; k++ )
+	acc[ k ] += acc[ k + h ];
+    p = acc[ 0 ];
+  }
+
+  for( ; j < n ; j++ )
+    p += a[ j ] * b[ j ];
+  return p;
+}
+
+template <class A> inline double sum_sqr( expr<A> const & a ) { return dot( a, a ); }
+template <class A> inline double norm( expr<A> const & a ) { return sqrt( dot( a, a ) ); }
+
+} /* namespace it */
+
+#endif /* __cplusplus */
+#endif
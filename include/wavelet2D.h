@@ -34,6 +34,12 @@
 extern "C" {
 #endif
 
+/* geometry of one decomposition level, computed once per image size */
+typedef struct _it_wavelet2D_level_ {
+  int width, height;             /* size of the image decomposed at this level */
+  int page;                      /* length of the buffer slots at this level */
+} it_wavelet2D_level_t;
+
 typedef struct _it_wavelet2D_ {
   it_extends(it_transform2D_t);
 
@@ -41,7 +47,10 @@ typedef struct _it_wavelet2D_ {
   int level;                     /* current decomposition level */
   int levels;                    /* number of decomposition levels */
   int width, height;             /* widthxheight of the original frame */
-  vec buffer;
+  vec buffer;                    /* allocated on first use */
+  vec scratch;                   /* of the in-place transform */
+  it_wavelet2D_level_t *plan;    /* levels + 1 entries, set with the size */
+  int precision;                 /* of the in-place transforms */
 
   void (* it_overloaded(destructor))(it_object_t *it_this);
 
@@ -59,11 +68,93 @@ static inline it_wavelet2D_t *it_wavelet2D_new(it_wavelet_lifting_t const *lifti
   return(it_new_va(it_wavelet2D_t)(it_va, lifting, level));
 }
 
+/* A transform for images of a fixed size, keeping its buffer and the
+   geometry of all its levels from one image to the next (a 'plan').    */
+static inline it_wavelet2D_t *it_wavelet2D_plan(it_wavelet_lifting_t const *lifting, int level,
+						 int width, int height)
+{
+  it_wavelet2D_t *wavelet = it_wavelet2D_new(lifting, level);
+
+  it_transform2D_set_size(wavelet, width, height);
+  return(wavelet);
+}
+
 #define it_wavelet2D_copy(a, b)  a->copy(a, b)
 
 /* 2D wavelet transform and inverse transform */
 #define it_wavelet2D_transform(t, m) ((mat) it_transform2D(IT_WAVELET2D(t), m))
 #define it_wavelet2D_itransform(t, m) ((mat) it_itransform2D(IT_WAVELET2D(t), m))
+/* same thing into a matrix of the size set beforehand, allocating nothing;
+   return -IT_EINVAL if the matrices do not have this size                */
+int it_wavelet2D_transform_into(it_wavelet2D_t *wavelet, mat image, mat flat);
+int it_wavelet2D_itransform_into(it_wavelet2D_t *wavelet, mat flat, mat image);
+/* same thing in place: the image is replaced by its coefficients, in the
+   same layout, or the other way round. Only a few lines are allocated. */
+int it_wavelet2D_transform_inplace(it_wavelet2D_t *wavelet, mat image);
+int it_wavelet2D_itransform_inplace(it_wavelet2D_t *wavelet, mat image);
+/* same thing for a detector that only needs some of the coefficients:
+   those of the bands asked for are the ones of the full transform, the
+   others are left undefined. The finest bands only take the first level;
+   the coarse ones skip the vertical filtering of the first high band.  */
+#define IT_WAVELET2D_FINEST 1      /* HL, LH and HH of level 0 */
+#define IT_WAVELET2D_COARSE 2      /* the bands of the next levels, and LL */
+int it_wavelet2D_transform_partial(it_wavelet2D_t *wavelet, mat image,
+				   int bands);
+/* Precision of the in-place transforms: in single precision, the lines of
+   the matrix are filtered as floats in their first half (half the memory
+   traffic, twice the lanes), the coefficients being given back as doubles.
+   The _float functions filter an image of floats directly.               */
+#define IT_WAVELET2D_F64 0
+#define IT_WAVELET2D_F32 1
+#define it_wavelet2D_set_precision(w, p) ((w)->precision = (p))
+int it_wavelet2D_transform_float(it_wavelet2D_t *wavelet, float **image);
+int it_wavelet2D_itransform_float(it_wavelet2D_t *wavelet, float **image);
+/* Error of the single precision against the double one on an image of the
+   size set beforehand: largest coefficient difference, loss of PSNR (dB,
+   peak 255) of the reconstruction, and pixels rounded differently by
+   mat_pgm_write after the reconstruction.                                */
+typedef struct _it_wavelet2D_error_ {
+  double max_error;
+  double psnr_delta;
+  int changed_pixels;
+} it_wavelet2D_error_t;
+
+int it_wavelet2D_precision_error(it_wavelet2D_t *wavelet, mat image,
+				 it_wavelet2D_error_t *error);
+/* same thing with the coefficients left in the transform, each band being
+   stored contiguously: it_wavelet2D_band gives the band of a level (0 is
+   the finest, LL only for the last one) and its size. The inverse
+   transform reads the bands from there.                                  */
+#define IT_WAVELET2D_LL 0
+#define IT_WAVELET2D_HL 1          /* high horizontal frequencies */
+#define IT_WAVELET2D_LH 2          /* high vertical frequencies */
+#define IT_WAVELET2D_HH 3
+int it_wavelet2D_transform_packed(it_wavelet2D_t *wavelet, mat image);
+int it_wavelet2D_itransform_packed(it_wavelet2D_t *wavelet, mat image);
+double *it_wavelet2D_band(it_wavelet2D_t *wavelet, int level, int band,
+			  int *width, int *height);
+/* Line-based transform of a width x height image, for images that do not
+   fit in memory: the lines are given one after the other, and each row of
+   a band is given out to emit as soon as it is final, rows in order for
+   each band. Only a few lines per level are kept. The coefficients are
+   the same as with it_wavelet2D_transform.                              */
+typedef void (* it_wavelet2D_emit_t)(void *arg, int level, int band, int row,
+				     double const *samples, int width);
+typedef struct _it_wavelet2D_stream_ it_wavelet2D_stream_t;
+
+it_wavelet2D_stream_t *it_wavelet2D_stream_new(it_wavelet_lifting_t const *lifting,
+					       int levels, int width, int height,
+					       it_wavelet2D_emit_t emit, void *arg);
+/* return -IT_EINVAL once the height lines have been given */
+int it_wavelet2D_stream_push(it_wavelet2D_stream_t *stream, double const *line);
+void it_wavelet2D_stream_delete(it_wavelet2D_stream_t *stream);
+
+/* Reversible integer 5/3 transform (JPEG 2000), in place on an image of
+   integers, in the same layout as it_wavelet2D_transform. The inverse
+   gives the image back exactly.                                        */
+int it_wavelet2D_53i_transform(imat image, int levels);
+int it_wavelet2D_53i_itransform(imat image, int levels);
+
 /* same thing with internal object construction/destruction */
 mat it_dwt2D(mat m, it_wavelet_lifting_t const *lifting, int levels);
 mat it_idwt2D(mat t, it_wavelet_lifting_t const *lifting, int levels);
@@ -73,6 +164,10 @@ mat it_idwt2D(mat t, it_wavelet_lifting_t const *lifting, int levels);
    All the memory is allocated inside.                                      */
 mat * it_wavelet2D_split( mat wav, int nb_levels );
 mat it_wavelet2D_merge( mat * subbands, int nb_level );
+/* Same split without copy: the 3 * nb_levels + 1 subbands, in the same
+   order, are views of the coefficients of wav, in place, that may be read
+   and written there.                                                    */
+void it_wavelet2D_split_view( mat_view wav, int nb_levels, mat_view * subbands );
 
 #ifdef __cplusplus
 }
@@ -11,13 +11,33 @@
 #include "include/extract.h"
 #include "include/project.h"
 #include "include/utils.h"
+#include "include/qim.h"
+#include "include/pool.h"
+#include "include/cache.h"
+#include "include/arena.h"
+#include "include/blas.h"
 #include "include/constants.h"
 
+#include <pthread.h>
 #include <iostream>
 using namespace std;
 
 #define LEVELS   4
 #define PAS      200
+#define STREAMING 1      // Porteuses regenerees a la volee (memoire O(image))
+#define KEYED     0      // Porteuses du generateur a compteur (acces direct)
+#define ORTHO     0      // Porteuses stockees orthonormalisees (STREAMING 0)
+#define JOINT     0      // Deplacements resolus conjointement (KEYED ou STREAMING 0)
+#define THREADS   0      // Nombre de threads (0 : un par coeur)
+#define STOCKAGE  QIM_F64 // Type des porteuses stockees : QIM_F64, QIM_F32, QIM_I8
+#define CACHE     0      // Porteuses stockees lues dans un cache disque (STREAMING 0)
+#define CACHE_DIR "."
+#define ARENA     0      // Temporaires alloues dans une arene liberee en fin de tache
+#define SOMMES    BLAS_ORDERED // Ordre des sommes : BLAS_ORDERED (resultats inchanges), BLAS_BLOCKED
+
+// Generateur des porteuses stockees, pour le cache
+#define GENERATEUR (CACHE_GEN_MT19937 | (ORTHO ? CACHE_GEN_ORTHO : 0) \
+                    | CACHE_GEN_TYPE(STOCKAGE))
 
 double val_abs(double a);          // Valeur absolue
 
@@ -28,6 +48,19 @@ int* dec2bin(int dec);             // Conversion entier -> binaire
 int oct2dec(int* oct);             // Conversion octal -> decimal
 char* bin2char(int* bin);          // Conversion binaire -> char*
 
+// Couche a tatouer : vecteur, clef et numero (0 : BF, 1 : HF)
+struct couche_t
+{
+    vec V;
+    unsigned int key[4];
+    int numero;
+    int* mot;
+    int nb_bits;
+    double pas;
+};
+
+void* tatouerCouche(void* arg);    // Tatouage d'une couche (thread)
+
 
 
 
@@ -37,6 +70,16 @@ int main (int argc, char **argv)
 {
     int i, j, k;
 
+    // Repartition des calculs sur les coeurs
+    pool_set_threads(THREADS);
+    blas_set_mode(SOMMES);
+
+#if ARENA
+    // Vecteurs et matrices de la tache alloues dans une arene
+    it_arena_t* arene = it_arena_new(1 << 20);
+    it_arena_use(arene);
+#endif
+
     //************************************************
     //  Lecture de l'image                           *
     //************************************************
@@ -75,7 +118,7 @@ int main (int argc, char **argv)
     //**************************************************
 
     it_wavelet2D_t *wavelet2D = NULL;
-    wavelet2D = it_wavelet2D_new (it_wavelet_lifting_97, LEVELS); // Caractrisation du domaine ondelette
+    wavelet2D = it_wavelet2D_plan (it_wavelet_lifting_97, LEVELS, w_I, h_I); // Caractrisation du domaine ondelette
 
     mat Wav_X = NULL;
     Wav_X = it_wavelet2D_transform (wavelet2D, I_X);              // Dcomposition dans le domaine ondelette
@@ -91,14 +134,14 @@ int main (int argc, char **argv)
     //  Dcomposition de l'image en 2 sous bandes BF/HF*
     //**************************************************
 
-    vec L1 = vec_new_zeros(dim_L1);
     vec HF = vec_new_zeros(dim_HF);         // Vecteur du domaine HF : Couche 2
     vec BF = vec_new_zeros(dim_BF);         // Vecteur du domaine BF : Couche 1
     vec SP = vec_new_zeros(dim_SP);         // Vecteur du domaine SP : Couche 0
-    extract (Wav_X, L1, HF, 1);             // Sparation de l'image en deux domaines BF-HF
+    extract (Wav_X, NULL, HF, 1);           // Sparation de l'image en deux domaines BF-HF
 
-    mat I2 = vec_to_mat( L1, w_I/2 );
-    extract (I2, SP, BF, LEVELS - 1);       // Sparation de l'image en deux domaines SP-BF
+    // Quart BF des coefficients, vu en place (sans copie)
+    mat_view Q_X = mat_get_submatrix_view (Wav_X, 0, 0, h_I/2 - 1, w_I/2 - 1);
+    extract_view (Q_X, SP, BF, LEVELS - 1); // Sparation de l'image en deux domaines SP-BF
 
 
 
@@ -134,174 +177,38 @@ int main (int argc, char **argv)
 
 
     //**************************************************
-    //   Initialisation de la clef BF                  *
+    //   Clefs des couches BF et HF                    *
     //**************************************************
 
     // Parametres de generation de la clef
-    unsigned int key[4];
     unsigned int key1 = 0;
     unsigned int key2 = 0;
     unsigned int key3 = 0;
     unsigned int key4 = 0;
 
-    key[0] = key1;
-    key[1] = key2;
-    key[2] = key3;
-    key[3] = key4;
-
-    // Initialisation des fonctions pseudo aleatoires
-    mt19937_srand_by_array(key, 4);
-
-
-
-    //**************************************************
-    //   Initialisation des porteuses BF               *
-    //**************************************************
-
-    vec* porteuses_BF;
-    porteuses_BF = new vec[nb_bits];
-    double produit = 0;
-
-    vec tmp = vec_new_zeros(dim_BF);
-    for (i = 0; i < nb_bits; i++)
-    {
-        porteuses_BF[i] = vec_new_zeros(dim_BF);
-        vec_randn(porteuses_BF[i]);
-
-        // Principe d'orthonormalisation de Gram-Schmidt
-        /*
-        for (j = 0; j < i; j++)
-        {
-            vec_copy(tmp, porteuses_BF[j]);
-            produit = vec_inner_product(porteuses_BF[i], tmp);
-            produit /= vec_inner_product(tmp, tmp);
-
-            vec_mul_by(tmp, produit);
-            vec_sub(porteuses_BF[i], tmp);
-        }
-        */
-
-        vec_normalize(porteuses_BF[i], 2);
-    }
-
-
-
-
-    //**************************************************
-    //   Tatouage dans les BF                          *
-    //**************************************************
-
     double pas = PAS;
-    double d1, d2, d;
-
-    int cellule = 0;
-    unsigned int bit = 0;
-
-    for (i = 0; i < nb_bits; i++)
-    {
-        // Produit scalaire avec les coeff basses frequences
-        produit = vec_inner_product(BF, porteuses_BF[i]);
 
-        // Cellule dans laquelle je suis
-        cellule = (int)floor(produit / pas);
+    couche_t couche_BF = { BF, { key1, key2, key3, key4 }, 0, mot, nb_bits, pas };
+    couche_t couche_HF = { HF, { 1 - key1, 1 - key2, 1 - key3, 1 - key4 }, 1,
+                           mot, nb_bits, pas };
 
-        // Bit codant
-        bit = (((int)val_abs(cellule)) % 2);
 
-        if (mot[i] == bit)
-        {
-           // Centre de cette cellule
-           d = (cellule + 0.5) * pas - produit;
-        }
-        else
-        {
-           // Choix de la cellule la plus proche
-           d1 = val_abs((cellule - 0.5) * pas - produit);
-           d2 = val_abs((cellule + 1.5) * pas - produit);
-
-           d = (cellule - 0.5) * pas - produit;
-           if (d2 < d1)
-           {
-              d = (cellule + 1.5) * pas  - produit;
-           }
-        }
-
-        vec_copy(tmp, porteuses_BF[i]);
-        vec_mul_by(tmp, d);
-        vec_add(BF, tmp);
-    }
 
     //**************************************************
-    //   Initialisation de la clef HF                  *
+    //   Tatouage des couches BF et HF                 *
+    //   Les deux couches sont tatouees en parallele,  *
+    //   chacune par un thread et avec son generateur  *
     //**************************************************
 
-    // Parametres de generation de la clef
-    key[0] = 1 - key1;
-    key[1] = 1 - key2;
-    key[2] = 1 - key3;
-    key[3] = 1 - key4;
-
-    // Initialisation des fonctions pseudo aleatoires
-    mt19937_srand_by_array(key, 4);
+    pthread_t thread_BF;
+    int parallele = (pthread_create(&thread_BF, NULL, tatouerCouche, &couche_BF) == 0);
 
+    if (!parallele)
+        tatouerCouche(&couche_BF);           // Sans second thread : BF puis HF
+    tatouerCouche(&couche_HF);
 
-
-    //**************************************************
-    //   Initialisation des porteuses HF               *
-    //**************************************************
-
-    // Concatenation de l'ensemble des coeff ondelettes
-
-    vec* porteuses_HF;
-    porteuses_HF = new vec[nb_bits];
-
-    tmp = vec_new_zeros(dim_HF);
-    for (i = 0; i < nb_bits; i++)
-    {
-        porteuses_HF[i] = vec_new_zeros(dim_HF);
-        vec_randn(porteuses_HF[i]);
-        vec_normalize(porteuses_HF[i], 2);
-    }
-
-
-
-    //**************************************************
-    //   Tatouage dans les HF                          *
-    //**************************************************
-
-    for (i = 0; i < nb_bits; i++)
-    {
-        // Produit scalaire avec l'image
-        produit = vec_inner_product(HF, porteuses_HF[i]);
-
-        // Cellule dans laquelle je suis
-        cellule = (int)floor(produit / pas);
-
-        // Bit codant
-        bit = (((int)val_abs(cellule)) % 2);
-
-        if (mot[i] == bit)
-        {
-           // Centre de la cellule
-           d = (cellule + 0.5) * pas - produit;
-        }
-        else
-        {
-           // Choix de la cellule la plus proche
-           d1 = val_abs((cellule - 0.5) * pas - produit);
-           d2 = val_abs((cellule + 1.5) * pas - produit);
-
-           d = (cellule - 0.5) * pas - produit;
-           if (d2 < d1)
-           {
-              d = (cellule + 1.5) * pas  - produit;
-           }
-        }
-
-        vec_copy(tmp, porteuses_HF[i]);
-        vec_mul_by(tmp, d);
-        vec_add(HF, tmp);
-    }
+    if (parallele)
+        pthread_join(thread_BF, NULL);
 
 
 
@@ -313,14 +220,15 @@ int main (int argc, char **argv)
     // split_HFBF(allHFBF, BF, HF);
 
     mat Wav_Y = NULL;
-    Wav_Y = mat_new_zeros(h_I, w_I);                 // Matrice image tatoue dans les ondelettes
-    extractInv(SP, BF, LEVELS-1, h_I/2, w_I/2, I2);
-    L1 = mat_to_vec(I2);
+    Wav_Y = mat_new(h_I, w_I);                       // Matrice image tatoue dans les ondelettes
+    extractInv(NULL, HF, 1, h_I, w_I, Wav_Y);        // Chaque coefficient est crit une fois, en place
+    extractInv_view(SP, BF, LEVELS-1,
+                    mat_get_submatrix_view(Wav_Y, 0, 0, h_I/2 - 1, w_I/2 - 1));
 
     // Transformation inverse
     mat I_Y = NULL;
-    extractInv(L1, HF, 1, h_I, w_I, Wav_Y);
-    I_Y = it_wavelet2D_itransform(wavelet2D, Wav_Y); // Matrice image tatoue
+    it_wavelet2D_itransform_inplace(wavelet2D, Wav_Y); // Reconstruction en place
+    I_Y = Wav_Y;                                     // Matrice image tatoue
     double psnr = mat_psnr (I_X, I_Y);               // Calcul du PSNR
 
     mat_pgm_write("IMAGE_TATOUEE.pgm", I_Y);
@@ -338,6 +246,14 @@ int main (int argc, char **argv)
         cout << mot[i];
 
     cout << endl << "Nb bits " << nb_bits << endl;
+#if ARENA
+    it_arena_stats_t statsArene = it_arena_stats(arene);
+    cout << "Arene : " << statsArene.allocs << " allocations, pic "
+         << statsArene.peak << " octets" << endl;
+    it_arena_use(NULL);
+    it_arena_delete(arene);
+#endif
+
     return (0);
 }
 /**************************************************************************** */
@@ -434,4 +350,136 @@ int longueurMsgBin(int* bin)
 
      return k;
 }
+
+void* tatouerCouche(void* arg)
+{
+    couche_t* c = (couche_t*) arg;
+    vec V = c->V;
+    int nb_bits = c->nb_bits;
+#if !KEYED && !STREAMING
+    int dim_V = vec_length(V);           // Dimension des porteuses stockees
+#endif
+
+    // Generateur du thread, initialise par la clef de la couche
+    mt19937_srand_by_array(c->key, 4);
+
+#if KEYED
+
+    //**************************************************
+    //   Porteuses tirees du generateur a compteur     *
+    //**************************************************
+
+#if JOINT
+    qim_embed_keyed_joint(V, c->key, c->mot, nb_bits, c->pas);
+#else
+    qim_embed_keyed(V, c->key, c->mot, nb_bits, c->pas);
+#endif
+
+#elif STREAMING
+
+    //**************************************************
+    //   Porteuses regenerees bloc par bloc            *
+    //**************************************************
+
+    qim_embed_stream(V, c->mot, nb_bits, c->pas);
+
+#elif STOCKAGE != QIM_F64
+
+    //**************************************************
+    //   Initialisation des porteuses compactes        *
+    //**************************************************
+
+    qim_packed_t* porteuses;
+    carrier_cache_t* cache = NULL;
+
+#if CACHE
+    // Porteuses deja tirees pour cette clef
+    cache = carrier_cache_open(CACHE_DIR, c->key, c->numero, dim_V, nb_bits, GENERATEUR);
+#endif
+
+    if (cache != NULL)
+        porteuses = cache->packed;
+    else
+    {
+        // Porteuses tirees une a une et compactees aussitot (ou tirees
+        // toutes en double puis orthonormalisees, avec ORTHO)
+        porteuses = qim_packed_randn(nb_bits, dim_V, STOCKAGE, ORTHO);
+
+#if CACHE
+        carrier_cache_write_packed(CACHE_DIR, c->key, c->numero, GENERATEUR, porteuses);
+#endif
+    }
+
+
+
+    //**************************************************
+    //   Tatouage                                      *
+    //**************************************************
+
+#if JOINT
+    qim_embed_joint_packed(V, porteuses, c->mot, c->pas);
+#else
+    qim_embed_packed(V, porteuses, c->mot, c->pas);
+#endif
+
+    if (cache != NULL)
+        carrier_cache_close(cache);
+
+#else
+
+    //**************************************************
+    //   Initialisation des porteuses                  *
+    //**************************************************
+
+    vec* porteuses;
+    carrier_cache_t* cache = NULL;
+    int i;
+
+#if CACHE
+    // Porteuses deja tirees pour cette clef
+    cache = carrier_cache_open(CACHE_DIR, c->key, c->numero, dim_V, nb_bits, GENERATEUR);
+#endif
+
+    if (cache != NULL)
+        porteuses = cache->carriers;
+    else
+    {
+        porteuses = new vec[nb_bits];
+
+        for (i = 0; i < nb_bits; i++)
+        {
+            porteuses[i] = vec_new_zeros(dim_V);
+            vec_randn(porteuses[i]);
+            vec_normalize(porteuses[i], 2);
+        }
+
+#if ORTHO
+        // Orthonormalisation de Gram-Schmidt (par blocs)
+        qim_orthonormalize(porteuses, nb_bits);
+#endif
+
+#if CACHE
+        carrier_cache_write(CACHE_DIR, c->key, c->numero, dim_V, nb_bits, GENERATEUR, porteuses);
+#endif
+    }
+
+
+
+    //**************************************************
+    //   Tatouage                                      *
+    //**************************************************
+
+#if JOINT
+    qim_embed_joint(V, porteuses, c->mot, nb_bits, c->pas);
+#else
+    qim_embed(V, porteuses, c->mot, nb_bits, c->pas);
+#endif
+
+    if (cache != NULL)
+        carrier_cache_close(cache);
+
+#endif
+
+    return NULL;
+}
 /**************************************************************************** */
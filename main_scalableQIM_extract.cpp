@@ -11,19 +11,61 @@
 #include "include/extract.h"
 #include "include/project.h"
 #include "include/utils.h"
+#include "include/qim.h"
+#include "include/pool.h"
+#include "include/cache.h"
+#include "include/arena.h"
+#include "include/blas.h"
 #include "include/constants.h"
 
+#include <pthread.h>
 #include <iostream>
 using namespace std;
 
 #define LEVELS   4
 #define PAS      200
+#define STREAMING 1      // Porteuses regenerees a la volee (memoire O(image))
+#define KEYED     0      // Porteuses du generateur a compteur (acces direct)
+#define ORTHO     0      // Porteuses stockees orthonormalisees (STREAMING 0)
+#define THREADS   0      // Nombre de threads (0 : un par coeur)
+#define STOCKAGE  QIM_F64 // Type des porteuses stockees : QIM_F64, QIM_F32, QIM_I8
+#define CACHE     0      // Porteuses stockees lues dans un cache disque (STREAMING 0)
+#define CACHE_DIR "."
+#define ARENA     0      // Temporaires alloues dans une arene liberee en fin de tache
+#define SOMMES    BLAS_ORDERED // Ordre des sommes : BLAS_ORDERED (resultats inchanges), BLAS_BLOCKED
+#define COUCHES   3      // Couches a detecter : 1 (BF), 2 (HF), 3 (BF et HF)
+#define FLUX      0      // Image lue et decomposee ligne a ligne (COUCHES 2)
+
+// Bandes de la decomposition utiles aux couches detectees
+#define BANDES (((COUCHES & 1) ? IT_WAVELET2D_COARSE : 0) \
+                | ((COUCHES & 2) ? IT_WAVELET2D_FINEST : 0))
+
+// Generateur des porteuses stockees, pour le cache
+#define GENERATEUR (CACHE_GEN_MT19937 | (ORTHO ? CACHE_GEN_ORTHO : 0) \
+                    | CACHE_GEN_TYPE(STOCKAGE))
+
+#if FLUX && COUCHES != 2
+#error "FLUX ne garde que les HF : COUCHES doit valoir 2"
+#endif
 
 double val_abs(double a);
 char* bin2char(int* bin);
 int oct2dec(int* oct);
 int bin2Lmsg(int* bin);
 
+// Couche a detecter : vecteur, clef et numero (0 : BF, 1 : HF)
+struct couche_t
+{
+   vec V;
+   unsigned int key[4];
+   int numero;
+   int* mot;
+   int nb_bits;
+   double pas;
+};
+
+void* detecterCouche(void* arg);   // Detection d'une couche (thread)
+
 
 
 
@@ -32,9 +74,18 @@ int bin2Lmsg(int* bin);
 int main (int argc, char **argv)
 {
 
+  // Repartition des calculs sur les coeurs
+  pool_set_threads(THREADS);
+  blas_set_mode(SOMMES);
+
+#if ARENA
+  // Vecteurs et matrices de la tache alloues dans une arene
+  it_arena_t* arene = it_arena_new(1 << 20);
+  it_arena_use(arene);
+#endif
+
   /* Arguments */
   char *inputFile;
-  unsigned int key[4];
   unsigned int key1, key2, key3, key4;
 
   key1 = 0;
@@ -42,18 +93,13 @@ int main (int argc, char **argv)
   key3 = 0;
   key4 = 0;
 
-  key[0] = key1;
-  key[1] = key2;
-  key[2] = key3;
-  key[3] = key4;
-
   mat I_X = NULL;                   /* Matrice image  tatouer */
   mat I_Y = NULL;                   /* Matrice image tatoue */
   unsigned int h_I, w_I, h, w;      /* Dimension image */
 
   /* Parametres d'initialisation */
   int dim_SP, dim_BF, dim_HF, dim;  /* Dimension des espaces */
-  vec L1, SP, HF, BF, image;        /* Image decompose */
+  vec SP, HF, BF, image;            /* Image decompose */
 
 
 
@@ -62,8 +108,19 @@ int main (int argc, char **argv)
    *************************************************/
 
    inputFile= argv[1];                              /* Fichier image a tatouer */
-   mt19937_srand_by_array(key, 4);                  /* Initialisation des fonctions alatoires */
 
+#if FLUX
+   // Image lue ligne a ligne, seules les HF du premier niveau sont gardees
+   int largeur, hauteur;
+   HF = extract_pgm_HF (inputFile, it_wavelet_lifting_97, &largeur, &hauteur);
+   if (HF == NULL)
+       return (1);
+   w_I = largeur;
+   h_I = hauteur;
+   dim = (h_I * w_I);                               /* Dimension de l'image */
+   dim_BF = dim / ((int) pow (2, (2 * 1)));         /* Dimension de l'espace BF */
+   dim_HF = vec_length (HF);                        /* Dimension de l'espace HF */
+#else
    I_X = mat_pgm_read(inputFile);                   /* Reprsentation matricielle dans le domaine spacial */
                                                     // mat_pgm_write ("IMAGE_ORIGINALE.pgm", I_X);
    h_I = mat_height(I_X);                           /* Hauteur de l'image */
@@ -82,8 +139,9 @@ int main (int argc, char **argv)
    mat Wav_X = NULL;
    it_wavelet2D_t *wavelet2D = NULL;
 
-   wavelet2D = it_wavelet2D_new (it_wavelet_lifting_97, LEVELS); /* Caractrisation du domaine ondelette */
-   Wav_X = it_wavelet2D_transform (wavelet2D, I_X);              /* Dcomposition dans le domaine ondelette */
+   wavelet2D = it_wavelet2D_plan (it_wavelet_lifting_97, LEVELS, w_I, h_I); /* Caractrisation du domaine ondelette */
+   it_wavelet2D_transform_partial (wavelet2D, I_X, BANDES);      /* Dcomposition en place, l'image n'tant plus utile */
+   Wav_X = I_X;
 
 
 
@@ -91,9 +149,9 @@ int main (int argc, char **argv)
    *  Dcomposition de l'image en 2 sous bandes BF/HF*
    ***************************************************/
 
-   L1 = vec_new_zeros (dim_BF);
-   HF = vec_new_zeros (dim_HF);        /* Vecteur du domaine HF : Couche 2 */
-   extract (Wav_X, L1, HF, 1);         /* Sparation de l'image en deux domaines BF-HF */
+   HF = (COUCHES & 2) ? vec_new_zeros (dim_HF) : NULL; /* Vecteur du domaine HF : Couche 2 */
+   extract (Wav_X, NULL, HF, 1);       /* Sparation de l'image en deux domaines BF-HF */
+#endif
 
 
 
@@ -102,6 +160,8 @@ int main (int argc, char **argv)
    ***************************************************/
 
    int i, j, k;
+
+#if COUCHES & 1
    w = w_I / (int)pow(2, LEVELS);
    h = h_I / (int)pow(2, LEVELS);
 
@@ -111,129 +171,98 @@ int main (int argc, char **argv)
    SP = vec_new_zeros(dim_SP);               /* Vecteur du domaine SP : Couche 0 */
    BF = vec_new_zeros(dim_BF);               /* Vecteur du domaine BF : Couche 1 */
 
-   mat I2 = NULL;
-   I2 = vec_to_mat( L1, w_I/2 );
-   extract (I2, SP, BF, LEVELS - 1);         /* Sparation de l'image en deux domaines BF-HF */
+   mat_view Q_X;                             /* Quart BF des coefficients, vu en place */
+   Q_X = mat_get_submatrix_view (Wav_X, 0, 0, h_I/2 - 1, w_I/2 - 1);
+   extract_view (Q_X, SP, BF, LEVELS - 1);   /* Sparation de l'image en deux domaines BF-HF */
+#endif
 
 
 
   /***************************************************
-   *   Initialisation des porteuses                  *
+   *   Nombre de bits et clefs des couches           *
    ***************************************************/
 
    int nb_bits = 0;
    printf("Nombre de bits a detecter : ");
    scanf("%d", &nb_bits);
 
-   int* mot;
-   mot = new int[nb_bits];
+   double pas = PAS;
 
-   // Initialisation du mot a inserer
-   for (i = 0; i < nb_bits; i++)
-   {
-       mot[i] = -1;
-   }
+   char* motInv;
 
-   vec* porteuses_BF;
-   porteuses_BF = new vec[nb_bits];
+#if COUCHES & 1
+   // Mot detecte dans les BF (suivi d'un octet de -1 pour bin2Lmsg)
+   int* mot_BF = new int[nb_bits + 8];
+   for (i = 0; i < nb_bits + 8; i++)
+       mot_BF[i] = -1;
 
-   // Initialisation porteuses aleatoire
-   for (i = 0; i < nb_bits; i++)
-   {
-       porteuses_BF[i] = vec_new_zeros(dim_BF);
-       vec_randn(porteuses_BF[i]);
-   }
+   couche_t couche_BF = { BF, { key1, key2, key3, key4 }, 0, mot_BF, nb_bits, pas };
+#endif
 
-   double produit = 0;
-   double pas = PAS;
+#if COUCHES & 2
+   // Mot detecte dans les HF
+   int* mot_HF = new int[nb_bits + 8];
+   for (i = 0; i < nb_bits + 8; i++)
+       mot_HF[i] = -1;
 
-   int cellule = 0;
-   unsigned int bit = 0;
+   couche_t couche_HF = { HF, { 1 - key1, 1 - key2, 1 - key3, 1 - key4 }, 1,
+                          mot_HF, nb_bits, pas };
+#endif
 
-   vec tmp = vec_new_zeros(dim_BF);
-   for (i = 0; i < nb_bits; i++)
-   {
-       vec_normalize(porteuses_BF[i], 2);
 
-       // Produit scalaire avec l'image
-       produit = vec_inner_product(BF, porteuses_BF[i]);
 
-       // Cellule dans laquelle je suis
-       cellule = (int)floor(produit / pas);
+  /***************************************************
+   *   Detection dans les couches BF et HF           *
+   *   Les deux couches sont detectees en parallele, *
+   *   chacune par un thread et avec son generateur  *
+   ***************************************************/
 
-       // Bit codant
-       bit = (((int)val_abs(cellule)) % 2);
-       mot[i] = bit;
-  }
+#if COUCHES == 3
+   pthread_t thread_BF;
+   int parallele = (pthread_create(&thread_BF, NULL, detecterCouche, &couche_BF) == 0);
+
+   if (!parallele)
+       detecterCouche(&couche_BF);         /* Sans second thread : BF puis HF */
+   detecterCouche(&couche_HF);
+
+   if (parallele)
+       pthread_join(thread_BF, NULL);
+#elif COUCHES & 1
+   detecterCouche(&couche_BF);
+#else
+   detecterCouche(&couche_HF);
+#endif
 
   cout << endl << "INFORMATION DETECTION" << endl;
 
-  char* motInv;
-  motInv = new char[bin2Lmsg(mot)];
-  motInv = bin2char(mot);
+#if COUCHES & 1
+  motInv = bin2char(mot_BF);
 
   cout << endl << "Message (BF) : ";
-  for (i = 0; i < bin2Lmsg(mot); i++)
+  for (i = 0; i < bin2Lmsg(mot_BF); i++)
       cout << motInv[i];
 
   cout << endl;
+#endif
 
-
-
-    //**************************************************
-    //   Initialisation de la clef HF                  *
-    //**************************************************
-
-    // Parametres de generation de la clef
-    key[0] = 1 - key1;
-    key[1] = 1 - key2;
-    key[2] = 1 - key3;
-    key[3] = 1 - key4;
-
-    // Initialisation des fonctions pseudo aleatoires
-    mt19937_srand_by_array(key, 4);
-
-
-
-    //**************************************************
-    //   Initialisation des porteuses HF               *
-    //**************************************************
-
-    vec* porteuses_HF;
-    porteuses_HF = new vec[nb_bits];
-
-    tmp = vec_new_zeros(dim_HF);
-    for (i = 0; i < nb_bits; i++)
-    {
-        porteuses_HF[i] = vec_new_zeros(dim_HF);
-        vec_randn(porteuses_HF[i]);
-        vec_normalize(porteuses_HF[i], 2);
-    }
-
-   for (i = 0; i < nb_bits; i++)
-   {
-       mot[i] = -1;
-       vec_normalize(porteuses_HF[i], 2);
-
-       // Produit scalaire avec l'image
-       produit = vec_inner_product(HF, porteuses_HF[i]);
-
-       // Cellule dans laquelle je suis
-       cellule = (int)floor(produit / pas);
-
-       // Bit codant
-       bit = (((int)val_abs(cellule)) % 2);
-       mot[i] = bit;
-  }
-
-  motInv = bin2char(mot);
+#if COUCHES & 2
+  motInv = bin2char(mot_HF);
 
   // TODO Ecrire dans un fichier
   cout << "Message (HF) : ";
-  for (i = 0; i < bin2Lmsg(mot); i++)
+  for (i = 0; i < bin2Lmsg(mot_HF); i++)
       cout << motInv[i];
 
   cout << endl;
+#endif
+
+#if ARENA
+  it_arena_stats_t statsArene = it_arena_stats(arene);
+  cout << "Arene : " << statsArene.allocs << " allocations, pic "
+       << statsArene.peak << " octets" << endl;
+  it_arena_use(NULL);
+  it_arena_delete(arene);
+#endif
 
   return (0);
 }
@@ -312,4 +341,93 @@ int bin2Lmsg(int* bin)
      return k;
 }
 
+void* detecterCouche(void* arg)
+{
+   couche_t* c = (couche_t*) arg;
+   vec V = c->V;
+   int nb_bits = c->nb_bits;
+#if !KEYED && !STREAMING
+   int dim_V = vec_length(V);           // Dimension des porteuses stockees
+#endif
+
+   // Generateur du thread, initialise par la clef de la couche
+   mt19937_srand_by_array(c->key, 4);
+
+#if KEYED
+   // Porteuses tirees du generateur a compteur
+   qim_detect_keyed(V, c->key, c->mot, nb_bits, c->pas);
+#elif STREAMING
+   // Porteuses regenerees bloc par bloc
+   qim_detect_stream(V, c->mot, nb_bits, c->pas);
+#elif STOCKAGE != QIM_F64
+   qim_packed_t* porteuses;
+   carrier_cache_t* cache = NULL;
+
+#if CACHE
+   // Porteuses deja tirees pour cette clef
+   cache = carrier_cache_open(CACHE_DIR, c->key, c->numero, dim_V, nb_bits, GENERATEUR);
+#endif
+
+   if (cache != NULL)
+       porteuses = cache->packed;
+   else
+   {
+       // Porteuses tirees une a une et compactees aussitot (ou tirees
+       // toutes en double puis orthonormalisees, avec ORTHO)
+       porteuses = qim_packed_randn(nb_bits, dim_V, STOCKAGE, ORTHO);
+
+#if CACHE
+       carrier_cache_write_packed(CACHE_DIR, c->key, c->numero, GENERATEUR, porteuses);
+#endif
+   }
+
+   // Detection sur les porteuses compactes
+   qim_detect_packed(V, porteuses, c->mot, c->pas);
+   if (cache == NULL)
+       qim_packed_delete(porteuses);
+   else
+       carrier_cache_close(cache);
+#else
+   vec* porteuses;
+   carrier_cache_t* cache = NULL;
+   int i;
+
+#if CACHE
+   // Porteuses deja tirees pour cette clef
+   cache = carrier_cache_open(CACHE_DIR, c->key, c->numero, dim_V, nb_bits, GENERATEUR);
+#endif
+
+   if (cache != NULL)
+       porteuses = cache->carriers;
+   else
+   {
+       porteuses = new vec[nb_bits];
+
+       // Initialisation porteuses aleatoire
+       for (i = 0; i < nb_bits; i++)
+       {
+           porteuses[i] = vec_new_zeros(dim_V);
+           vec_randn(porteuses[i]);
+           vec_normalize(porteuses[i], 2);
+       }
+
+#if ORTHO
+       // Orthonormalisation de Gram-Schmidt (par blocs)
+       qim_orthonormalize(porteuses, nb_bits);
+#endif
+
+#if CACHE
+       carrier_cache_write(CACHE_DIR, c->key, c->numero, dim_V, nb_bits, GENERATEUR, porteuses);
+#endif
+   }
+
+   qim_detect(V, porteuses, c->mot, nb_bits, c->pas);
+   if (cache != NULL)
+       carrier_cache_close(cache);
+#endif
+
+   return NULL;
+}
+
+
 
@@ -0,0 +1,167 @@
+/*
+  Antipodal carriers packed as bits.
+*/
+
+#include "../include/antipodal.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* number of host samples kept in cache while all the carriers go by */
+#define ANTIPODAL_TILE 1024
+
+static const double antipodal_sign[2] = { -1., 1. };
+
+#ifdef __SSE2__
+#define SIGN_BIT 0x8000000000000000ULL
+
+/* sign masks of two consecutive samples, indexed by their two bits */
+static const unsigned long long antipodal_mask[4][2] = {
+  {SIGN_BIT, SIGN_BIT}, {0, SIGN_BIT}, {SIGN_BIT, 0}, {0, 0}
+};
+
+#define MASK(b) _mm_castsi128_pd (_mm_loadu_si128 ((const __m128i *) \
+						   antipodal_mask[b]))
+#endif
+
+/* n <= 32 bits of alea starting at bit k, which is returned as the lsb */
+static unsigned int
+antipodal_bits (unsigned int const *alea, long k, int n)
+{
+  unsigned int w = alea[k >> 5] >> (k & 31);
+
+  if ((k & 31) + n > 32)
+    w |= alea[(k >> 5) + 1] << (32 - (k & 31));
+
+  return (w);
+}
+
+
+/*****************************************
+ *  Projection on the carriers           *
+ *****************************************/
+
+void
+antipodal_project (const double *s, int N_s, unsigned int const *alea,
+		   double *v, int N_v)
+{
+  int i, j, j0, j1, n, r, t;
+  unsigned int b[8];
+
+  for (j0 = 0; j0 < N_s; j0 = j1)
+    {
+      j1 = (N_s - j0 < ANTIPODAL_TILE) ? N_s : j0 + ANTIPODAL_TILE;
+      i = 0;
+
+#ifdef __SSE2__
+      /* 8 carriers at a time, lane l of register r holding carrier
+         i + 2r + l: each sum is still made in the order of j       */
+      for (; i + 8 <= N_v; i += 8)
+	{
+	  __m128d a[4];
+
+	  for (r = 0; r < 4; r++)
+	    a[r] = _mm_loadu_pd (v + i + 2 * r);
+
+	  for (j = j0; j < j1; j += n)
+	    {
+	      n = (j1 - j < 32) ? j1 - j : 32;
+	      for (r = 0; r < 8; r++)
+		b[r] = antipodal_bits (alea, (long) (i + r) * N_s + j, n);
+
+	      for (t = 0; t < n; t++)
+		{
+		  __m128d x = _mm_set1_pd (s[j + t]);
+
+		  for (r = 0; r < 4; r++)
+		    {
+		      int m = (b[2 * r] & 1) | ((b[2 * r + 1] & 1) << 1);
+
+		      a[r] = _mm_add_pd (a[r], _mm_xor_pd (x, MASK (m)));
+		      b[2 * r] >>= 1;
+		      b[2 * r + 1] >>= 1;
+		    }
+		}
+	    }
+
+	  for (r = 0; r < 4; r++)
+	    _mm_storeu_pd (v + i + 2 * r, a[r]);
+	}
+#endif
+
+      for (; i < N_v; i++)
+	{
+	  double p = v[i];
+
+	  for (j = j0; j < j1; j += n)
+	    {
+	      n = (j1 - j < 32) ? j1 - j : 32;
+	      b[0] = antipodal_bits (alea, (long) i * N_s + j, n);
+
+	      for (t = 0; t < n; t++, b[0] >>= 1)
+		p += antipodal_sign[b[0] & 1] * s[j + t];
+	    }
+
+	  v[i] = p;
+	}
+    }
+}
+
+
+/*****************************************
+ *  Embedding along the carriers         *
+ *  16 host samples are kept in          *
+ *  registers while all the carriers go  *
+ *  by.                                  *
+ *****************************************/
+
+void
+antipodal_embed (const double *v, int N_v, unsigned int const *alea,
+		 double *s, int N_s)
+{
+  int i, j0, n, t;
+  unsigned int b;
+  double a[16];
+
+  for (j0 = 0; j0 < N_s; j0 += n)
+    {
+      n = (N_s - j0 < 16) ? N_s - j0 : 16;
+
+#ifdef __SSE2__
+      if (n == 16)
+	{
+	  __m128d w[8];
+
+	  for (t = 0; t < 8; t++)
+	    w[t] = _mm_loadu_pd (s + j0 + 2 * t);
+
+	  for (i = 0; i < N_v; i++)
+	    {
+	      __m128d x = _mm_set1_pd (v[i]);
+
+	      b = antipodal_bits (alea, (long) i * N_s + j0, 16);
+	      for (t = 0; t < 8; t++, b >>= 2)
+		w[t] = _mm_add_pd (w[t], _mm_xor_pd (x, MASK (b & 3)));
+	    }
+
+	  for (t = 0; t < 8; t++)
+	    _mm_storeu_pd (s + j0 + 2 * t, w[t]);
+	  continue;
+	}
+#endif
+
+      for (t = 0; t < n; t++)
+	a[t] = s[j0 + t];
+
+      for (i = 0; i < N_v; i++)
+	{
+	  b = antipodal_bits (alea, (long) i * N_s + j0, n);
+	  for (t = 0; t < n; t++, b >>= 1)
+	    a[t] += antipodal_sign[b & 1] * v[i];
+	}
+
+      for (t = 0; t < n; t++)
+	s[j0 + t] = a[t];
+    }
+}
@@ -0,0 +1,164 @@
+/*
+   libit - Library for basic source and channel coding functions
+   Copyright (C) 2005-2005 Vivien Chappelier, Herve Jegou
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/*
+  Arenas of vectors and matrices
+  Copyright (C) 2005 Vivien Chappelier, Herve Jegou
+*/
+
+#include <stdlib.h>
+#include "../include/arena.h"
+#include "../include/vec.h"
+#include "../include/io.h"
+
+#if defined(_MSC_VER)
+#define IT_THREAD_LOCAL __declspec(thread)
+#else
+#define IT_THREAD_LOCAL __thread
+#endif
+
+/* alignment of the blocks handed out, and of the chunk data */
+#define IT_ARENA_ALIGN 16
+#define __arena_round( n ) (((n) + IT_ARENA_ALIGN - 1) & ~((size_t) IT_ARENA_ALIGN - 1))
+#define __arena_header_size __arena_round(sizeof(it_arena_chunk_t))
+#define __arena_data( c ) ((char *) (c) + __arena_header_size)
+
+static IT_THREAD_LOCAL it_arena_t *__it_arena = NULL;
+
+static it_arena_chunk_t *__arena_chunk_new(size_t size)
+{
+  it_arena_chunk_t *chunk;
+
+  chunk = (it_arena_chunk_t *) malloc(__arena_header_size + size);
+  it_assert( chunk != NULL, "No enough memory to allocate the arena" );
+  Vec_alloc_account(__arena_header_size + size);
+  chunk->next = NULL;
+  chunk->size = size;
+  return(chunk);
+}
+
+static void __arena_free_chunks(it_arena_t *arena)
+{
+  it_arena_chunk_t *chunk, *next;
+
+  for(chunk = arena->chunks; chunk; chunk = next) {
+    next = chunk->next;
+    free(chunk);
+  }
+  arena->chunks = NULL;
+  arena->top = arena->end = NULL;
+  arena->stats.chunks = 0;
+  arena->stats.reserved = 0;
+}
+
+/* make the chunk the one in use */
+static void __arena_push_chunk(it_arena_t *arena, it_arena_chunk_t *chunk)
+{
+  chunk->next = arena->chunks;
+  arena->chunks = chunk;
+  arena->top = __arena_data(chunk);
+  arena->end = arena->top + chunk->size;
+  arena->stats.chunks++;
+  arena->stats.reserved += chunk->size;
+}
+
+it_arena_t *it_arena_new(size_t chunk_size)
+{
+  it_arena_t *arena;
+
+  arena = (it_arena_t *) malloc(sizeof(it_arena_t));
+  it_assert( arena != NULL, "No enough memory to allocate the arena" );
+  Vec_alloc_account(sizeof(it_arena_t));
+  arena->chunks = NULL;
+  arena->top = arena->end = NULL;
+  arena->chunk_size = __arena_round(chunk_size);
+  arena->stats.allocs = 0;
+  arena->stats.resets = 0;
+  arena->stats.chunks = 0;
+  arena->stats.used = 0;
+  arena->stats.peak = 0;
+  arena->stats.reserved = 0;
+  return(arena);
+}
+
+void it_arena_delete(it_arena_t *arena)
+{
+  if(__it_arena == arena)
+    __it_arena = NULL;
+  __arena_free_chunks(arena);
+  free(arena);
+}
+
+void it_arena_reset(it_arena_t *arena)
+{
+  size_t reserved = arena->stats.reserved;
+
+  /* the next job fits in one chunk if it does not need more than this one */
+  if(arena->stats.chunks > 1) {
+    __arena_free_chunks(arena);
+    __arena_push_chunk(arena, __arena_chunk_new(reserved));
+  }
+  else if(arena->chunks) {
+    arena->top = __arena_data(arena->chunks);
+    arena->end = arena->top + arena->chunks->size;
+  }
+
+  arena->stats.allocs = 0;
+  arena->stats.used = 0;
+  arena->stats.resets++;
+}
+
+it_arena_t *it_arena_use(it_arena_t *arena)
+{
+  it_arena_t *previous = __it_arena;
+
+  __it_arena = arena;
+  return(previous);
+}
+
+it_arena_t *it_arena_current(void)
+{
+  return(__it_arena);
+}
+
+void *it_arena_alloc(size_t size)
+{
+  it_arena_t *arena = __it_arena;
+  size_t chunk_size;
+  char *p;
+
+  if(!arena)
+    return(NULL);
+
+  size = __arena_round(size);
+  if((size_t) (arena->end - arena->top) < size) {
+    chunk_size = arena->chunk_size;
+    if(chunk_size < size)
+      chunk_size = size;
+    __arena_push_chunk(arena, __arena_chunk_new(chunk_size));
+  }
+
+  p = arena->top;
+  arena->top += size;
+  arena->stats.allocs++;
+  arena->stats.used += size;
+  if(arena->stats.used > arena->stats.peak)
+    arena->stats.peak = arena->stats.used;
+  return(p);
+}
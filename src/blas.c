@@ -0,0 +1,1014 @@
+/*
+  Vector kernels of the level 1 operations on vectors of doubles.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+
+#include "../include/blas.h"
+
+/* a multiply-add must not be fused, whatever the instruction set */
+#ifdef __GNUC__
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define BLAS_X86
+#include <immintrin.h>
+#define TARGET(isa) __attribute__ ((target (isa)))
+#endif
+
+/* The blocked reductions add the terms of the first n samples, n being a
+   multiple of BLAS_LANES, to the partial sums acc[0..BLAS_LANES-1]; sum
+   adds the absolute values if absolute is set.                           */
+typedef struct _blas_kernels_
+{
+  void (*add) (double *x, const double *y, int n);
+  void (*sub) (double *x, const double *y, int n);
+  void (*scale) (double *x, double a, int n);
+  void (*div) (double *x, double a, int n);
+  void (*axpy) (double *y, double a, const double *x, int n);
+  void (*axpby) (double *y, double a, const double *x, double b, int n);
+  void (*dot) (double *acc, const double *x, const double *y, int n);
+  void (*sum) (double *acc, const double *x, int n, int absolute);
+  void (*axpy_dot) (double *acc, double *y, double a, const double *x,
+		    const double *z, int n);
+} blas_kernels_t;
+
+
+/*****************************************
+ *  Plain C                              *
+ *  Also used for the tails of the       *
+ *  vector kernels.                      *
+ *****************************************/
+
+static void
+add_c (double *x, const double *y, int n)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+    x[j] += y[j];
+}
+
+static void
+sub_c (double *x, const double *y, int n)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+    x[j] -= y[j];
+}
+
+static void
+scale_c (double *x, double a, int n)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+    x[j] *= a;
+}
+
+static void
+div_c (double *x, double a, int n)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+    x[j] /= a;
+}
+
+static void
+axpy_c (double *y, double a, const double *x, int n)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+    y[j] += a * x[j];
+}
+
+static void
+axpby_c (double *y, double a, const double *x, double b, int n)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+    y[j] = a * x[j] + b * y[j];
+}
+
+static void
+dot_c (double *acc, const double *x, const double *y, int n)
+{
+  int j, k;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    for (k = 0; k < BLAS_LANES; k++)
+      acc[k] += x[j + k] * y[j + k];
+}
+
+static void
+sum_c (double *acc, const double *x, int n, int absolute)
+{
+  int j, k;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    for (k = 0; k < BLAS_LANES; k++)
+      acc[k] += absolute ? fabs (x[j + k]) : x[j + k];
+}
+
+/* z is read after y is updated, z being possibly y */
+static void
+axpy_dot_c (double *acc, double *y, double a, const double *x,
+	    const double *z, int n)
+{
+  int j, k;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    for (k = 0; k < BLAS_LANES; k++)
+      {
+	y[j + k] += a * x[j + k];
+	acc[k] += y[j + k] * z[j + k];
+      }
+}
+
+#ifdef BLAS_X86
+
+/*****************************************
+ *  SSE2                                 *
+ *  Partial sums k and k + 1 in the      *
+ *  register k / 2.                      *
+ *****************************************/
+
+TARGET ("sse2")
+static void
+add_sse2 (double *x, const double *y, int n)
+{
+  int j;
+
+  for (j = 0; j + 2 <= n; j += 2)
+    _mm_storeu_pd (x + j, _mm_add_pd (_mm_loadu_pd (x + j),
+				      _mm_loadu_pd (y + j)));
+
+  add_c (x + j, y + j, n - j);
+}
+
+TARGET ("sse2")
+static void
+sub_sse2 (double *x, const double *y, int n)
+{
+  int j;
+
+  for (j = 0; j + 2 <= n; j += 2)
+    _mm_storeu_pd (x + j, _mm_sub_pd (_mm_loadu_pd (x + j),
+				      _mm_loadu_pd (y + j)));
+
+  sub_c (x + j, y + j, n - j);
+}
+
+TARGET ("sse2")
+static void
+scale_sse2 (double *x, double a, int n)
+{
+  __m128d k = _mm_set1_pd (a);
+  int j;
+
+  for (j = 0; j + 2 <= n; j += 2)
+    _mm_storeu_pd (x + j, _mm_mul_pd (_mm_loadu_pd (x + j), k));
+
+  scale_c (x + j, a, n - j);
+}
+
+TARGET ("sse2")
+static void
+div_sse2 (double *x, double a, int n)
+{
+  __m128d k = _mm_set1_pd (a);
+  int j;
+
+  for (j = 0; j + 2 <= n; j += 2)
+    _mm_storeu_pd (x + j, _mm_div_pd (_mm_loadu_pd (x + j), k));
+
+  div_c (x + j, a, n - j);
+}
+
+TARGET ("sse2")
+static void
+axpy_sse2 (double *y, double a, const double *x, int n)
+{
+  __m128d k = _mm_set1_pd (a);
+  int j;
+
+  for (j = 0; j + 2 <= n; j += 2)
+    _mm_storeu_pd (y + j, _mm_add_pd (_mm_loadu_pd (y + j),
+				      _mm_mul_pd (k, _mm_loadu_pd (x + j))));
+
+  axpy_c (y + j, a, x + j, n - j);
+}
+
+TARGET ("sse2")
+static void
+axpby_sse2 (double *y, double a, const double *x, double b, int n)
+{
+  __m128d ka = _mm_set1_pd (a), kb = _mm_set1_pd (b);
+  int j;
+
+  for (j = 0; j + 2 <= n; j += 2)
+    _mm_storeu_pd (y + j, _mm_add_pd (_mm_mul_pd (ka, _mm_loadu_pd (x + j)),
+				      _mm_mul_pd (kb, _mm_loadu_pd (y + j))));
+
+  axpby_c (y + j, a, x + j, b, n - j);
+}
+
+TARGET ("sse2")
+static void
+dot_sse2 (double *acc, const double *x, const double *y, int n)
+{
+  __m128d a0 = _mm_loadu_pd (acc), a1 = _mm_loadu_pd (acc + 2);
+  __m128d a2 = _mm_loadu_pd (acc + 4), a3 = _mm_loadu_pd (acc + 6);
+  __m128d a4 = _mm_loadu_pd (acc + 8), a5 = _mm_loadu_pd (acc + 10);
+  __m128d a6 = _mm_loadu_pd (acc + 12), a7 = _mm_loadu_pd (acc + 14);
+  int j;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    {
+      a0 = _mm_add_pd (a0, _mm_mul_pd (_mm_loadu_pd (x + j),
+				       _mm_loadu_pd (y + j)));
+      a1 = _mm_add_pd (a1, _mm_mul_pd (_mm_loadu_pd (x + j + 2),
+				       _mm_loadu_pd (y + j + 2)));
+      a2 = _mm_add_pd (a2, _mm_mul_pd (_mm_loadu_pd (x + j + 4),
+				       _mm_loadu_pd (y + j + 4)));
+      a3 = _mm_add_pd (a3, _mm_mul_pd (_mm_loadu_pd (x + j + 6),
+				       _mm_loadu_pd (y + j + 6)));
+      a4 = _mm_add_pd (a4, _mm_mul_pd (_mm_loadu_pd (x + j + 8),
+				       _mm_loadu_pd (y + j + 8)));
+      a5 = _mm_add_pd (a5, _mm_mul_pd (_mm_loadu_pd (x + j + 10),
+				       _mm_loadu_pd (y + j + 10)));
+      a6 = _mm_add_pd (a6, _mm_mul_pd (_mm_loadu_pd (x + j + 12),
+				       _mm_loadu_pd (y + j + 12)));
+      a7 = _mm_add_pd (a7, _mm_mul_pd (_mm_loadu_pd (x + j + 14),
+				       _mm_loadu_pd (y + j + 14)));
+    }
+
+  _mm_storeu_pd (acc, a0);
+  _mm_storeu_pd (acc + 2, a1);
+  _mm_storeu_pd (acc + 4, a2);
+  _mm_storeu_pd (acc + 6, a3);
+  _mm_storeu_pd (acc + 8, a4);
+  _mm_storeu_pd (acc + 10, a5);
+  _mm_storeu_pd (acc + 12, a6);
+  _mm_storeu_pd (acc + 14, a7);
+}
+
+TARGET ("sse2")
+static void
+sum_sse2 (double *acc, const double *x, int n, int absolute)
+{
+  __m128d m = _mm_castsi128_pd (_mm_set1_epi64x (absolute
+						 ? 0x7fffffffffffffffLL
+						 : -1LL));
+  __m128d a0 = _mm_loadu_pd (acc), a1 = _mm_loadu_pd (acc + 2);
+  __m128d a2 = _mm_loadu_pd (acc + 4), a3 = _mm_loadu_pd (acc + 6);
+  __m128d a4 = _mm_loadu_pd (acc + 8), a5 = _mm_loadu_pd (acc + 10);
+  __m128d a6 = _mm_loadu_pd (acc + 12), a7 = _mm_loadu_pd (acc + 14);
+  int j;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    {
+      a0 = _mm_add_pd (a0, _mm_and_pd (m, _mm_loadu_pd (x + j)));
+      a1 = _mm_add_pd (a1, _mm_and_pd (m, _mm_loadu_pd (x + j + 2)));
+      a2 = _mm_add_pd (a2, _mm_and_pd (m, _mm_loadu_pd (x + j + 4)));
+      a3 = _mm_add_pd (a3, _mm_and_pd (m, _mm_loadu_pd (x + j + 6)));
+      a4 = _mm_add_pd (a4, _mm_and_pd (m, _mm_loadu_pd (x + j + 8)));
+      a5 = _mm_add_pd (a5, _mm_and_pd (m, _mm_loadu_pd (x + j + 10)));
+      a6 = _mm_add_pd (a6, _mm_and_pd (m, _mm_loadu_pd (x + j + 12)));
+      a7 = _mm_add_pd (a7, _mm_and_pd (m, _mm_loadu_pd (x + j + 14)));
+    }
+
+  _mm_storeu_pd (acc, a0);
+  _mm_storeu_pd (acc + 2, a1);
+  _mm_storeu_pd (acc + 4, a2);
+  _mm_storeu_pd (acc + 6, a3);
+  _mm_storeu_pd (acc + 8, a4);
+  _mm_storeu_pd (acc + 10, a5);
+  _mm_storeu_pd (acc + 12, a6);
+  _mm_storeu_pd (acc + 14, a7);
+}
+
+/* y += k x on two samples, then acc + y z */
+TARGET ("sse2")
+static inline __m128d
+axpy_dot2_sse2 (__m128d acc, double *y, __m128d k, const double *x,
+		const double *z)
+{
+  __m128d t = _mm_add_pd (_mm_loadu_pd (y), _mm_mul_pd (k, _mm_loadu_pd (x)));
+
+  _mm_storeu_pd (y, t);
+  return (_mm_add_pd (acc, _mm_mul_pd (t, _mm_loadu_pd (z))));
+}
+
+TARGET ("sse2")
+static void
+axpy_dot_sse2 (double *acc, double *y, double a, const double *x,
+	       const double *z, int n)
+{
+  __m128d k = _mm_set1_pd (a);
+  __m128d a0 = _mm_loadu_pd (acc), a1 = _mm_loadu_pd (acc + 2);
+  __m128d a2 = _mm_loadu_pd (acc + 4), a3 = _mm_loadu_pd (acc + 6);
+  __m128d a4 = _mm_loadu_pd (acc + 8), a5 = _mm_loadu_pd (acc + 10);
+  __m128d a6 = _mm_loadu_pd (acc + 12), a7 = _mm_loadu_pd (acc + 14);
+  int j;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    {
+      a0 = axpy_dot2_sse2 (a0, y + j, k, x + j, z + j);
+      a1 = axpy_dot2_sse2 (a1, y + j + 2, k, x + j + 2, z + j + 2);
+      a2 = axpy_dot2_sse2 (a2, y + j + 4, k, x + j + 4, z + j + 4);
+      a3 = axpy_dot2_sse2 (a3, y + j + 6, k, x + j + 6, z + j + 6);
+      a4 = axpy_dot2_sse2 (a4, y + j + 8, k, x + j + 8, z + j + 8);
+      a5 = axpy_dot2_sse2 (a5, y + j + 10, k, x + j + 10, z + j + 10);
+      a6 = axpy_dot2_sse2 (a6, y + j + 12, k, x + j + 12, z + j + 12);
+      a7 = axpy_dot2_sse2 (a7, y + j + 14, k, x + j + 14, z + j + 14);
+    }
+
+  _mm_storeu_pd (acc, a0);
+  _mm_storeu_pd (acc + 2, a1);
+  _mm_storeu_pd (acc + 4, a2);
+  _mm_storeu_pd (acc + 6, a3);
+  _mm_storeu_pd (acc + 8, a4);
+  _mm_storeu_pd (acc + 10, a5);
+  _mm_storeu_pd (acc + 12, a6);
+  _mm_storeu_pd (acc + 14, a7);
+}
+
+
+/*****************************************
+ *  AVX                                  *
+ *  Partial sums k to k + 3 in the       *
+ *  register k / 4.                      *
+ *****************************************/
+
+TARGET ("avx")
+static void
+add_avx (double *x, const double *y, int n)
+{
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    _mm256_storeu_pd (x + j, _mm256_add_pd (_mm256_loadu_pd (x + j),
+					    _mm256_loadu_pd (y + j)));
+
+  add_c (x + j, y + j, n - j);
+}
+
+TARGET ("avx")
+static void
+sub_avx (double *x, const double *y, int n)
+{
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    _mm256_storeu_pd (x + j, _mm256_sub_pd (_mm256_loadu_pd (x + j),
+					    _mm256_loadu_pd (y + j)));
+
+  sub_c (x + j, y + j, n - j);
+}
+
+TARGET ("avx")
+static void
+scale_avx (double *x, double a, int n)
+{
+  __m256d k = _mm256_set1_pd (a);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    _mm256_storeu_pd (x + j, _mm256_mul_pd (_mm256_loadu_pd (x + j), k));
+
+  scale_c (x + j, a, n - j);
+}
+
+TARGET ("avx")
+static void
+div_avx (double *x, double a, int n)
+{
+  __m256d k = _mm256_set1_pd (a);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    _mm256_storeu_pd (x + j, _mm256_div_pd (_mm256_loadu_pd (x + j), k));
+
+  div_c (x + j, a, n - j);
+}
+
+TARGET ("avx")
+static void
+axpy_avx (double *y, double a, const double *x, int n)
+{
+  __m256d k = _mm256_set1_pd (a);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    _mm256_storeu_pd (y + j,
+		      _mm256_add_pd (_mm256_loadu_pd (y + j),
+				     _mm256_mul_pd (k, _mm256_loadu_pd (x + j))));
+
+  axpy_c (y + j, a, x + j, n - j);
+}
+
+TARGET ("avx")
+static void
+axpby_avx (double *y, double a, const double *x, double b, int n)
+{
+  __m256d ka = _mm256_set1_pd (a), kb = _mm256_set1_pd (b);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    _mm256_storeu_pd (y + j,
+		      _mm256_add_pd (_mm256_mul_pd (ka, _mm256_loadu_pd (x + j)),
+				     _mm256_mul_pd (kb,
+						    _mm256_loadu_pd (y + j))));
+
+  axpby_c (y + j, a, x + j, b, n - j);
+}
+
+TARGET ("avx")
+static void
+dot_avx (double *acc, const double *x, const double *y, int n)
+{
+  __m256d a0 = _mm256_loadu_pd (acc), a1 = _mm256_loadu_pd (acc + 4);
+  __m256d a2 = _mm256_loadu_pd (acc + 8), a3 = _mm256_loadu_pd (acc + 12);
+  int j;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    {
+      a0 = _mm256_add_pd (a0, _mm256_mul_pd (_mm256_loadu_pd (x + j),
+					     _mm256_loadu_pd (y + j)));
+      a1 = _mm256_add_pd (a1, _mm256_mul_pd (_mm256_loadu_pd (x + j + 4),
+					     _mm256_loadu_pd (y + j + 4)));
+      a2 = _mm256_add_pd (a2, _mm256_mul_pd (_mm256_loadu_pd (x + j + 8),
+					     _mm256_loadu_pd (y + j + 8)));
+      a3 = _mm256_add_pd (a3, _mm256_mul_pd (_mm256_loadu_pd (x + j + 12),
+					     _mm256_loadu_pd (y + j + 12)));
+    }
+
+  _mm256_storeu_pd (acc, a0);
+  _mm256_storeu_pd (acc + 4, a1);
+  _mm256_storeu_pd (acc + 8, a2);
+  _mm256_storeu_pd (acc + 12, a3);
+}
+
+TARGET ("avx")
+static void
+sum_avx (double *acc, const double *x, int n, int absolute)
+{
+  __m256d m = _mm256_castsi256_pd (_mm256_set1_epi64x (absolute
+						       ? 0x7fffffffffffffffLL
+						       : -1LL));
+  __m256d a0 = _mm256_loadu_pd (acc), a1 = _mm256_loadu_pd (acc + 4);
+  __m256d a2 = _mm256_loadu_pd (acc + 8), a3 = _mm256_loadu_pd (acc + 12);
+  int j;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    {
+      a0 = _mm256_add_pd (a0, _mm256_and_pd (m, _mm256_loadu_pd (x + j)));
+      a1 = _mm256_add_pd (a1, _mm256_and_pd (m, _mm256_loadu_pd (x + j + 4)));
+      a2 = _mm256_add_pd (a2, _mm256_and_pd (m, _mm256_loadu_pd (x + j + 8)));
+      a3 = _mm256_add_pd (a3, _mm256_and_pd (m,
+					     _mm256_loadu_pd (x + j + 12)));
+    }
+
+  _mm256_storeu_pd (acc, a0);
+  _mm256_storeu_pd (acc + 4, a1);
+  _mm256_storeu_pd (acc + 8, a2);
+  _mm256_storeu_pd (acc + 12, a3);
+}
+
+/* y += k x on four samples, then acc + y z */
+TARGET ("avx")
+static inline __m256d
+axpy_dot4_avx (__m256d acc, double *y, __m256d k, const double *x,
+	       const double *z)
+{
+  __m256d t = _mm256_add_pd (_mm256_loadu_pd (y),
+			     _mm256_mul_pd (k, _mm256_loadu_pd (x)));
+
+  _mm256_storeu_pd (y, t);
+  return (_mm256_add_pd (acc, _mm256_mul_pd (t, _mm256_loadu_pd (z))));
+}
+
+TARGET ("avx")
+static void
+axpy_dot_avx (double *acc, double *y, double a, const double *x,
+	      const double *z, int n)
+{
+  __m256d k = _mm256_set1_pd (a);
+  __m256d a0 = _mm256_loadu_pd (acc), a1 = _mm256_loadu_pd (acc + 4);
+  __m256d a2 = _mm256_loadu_pd (acc + 8), a3 = _mm256_loadu_pd (acc + 12);
+  int j;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    {
+      a0 = axpy_dot4_avx (a0, y + j, k, x + j, z + j);
+      a1 = axpy_dot4_avx (a1, y + j + 4, k, x + j + 4, z + j + 4);
+      a2 = axpy_dot4_avx (a2, y + j + 8, k, x + j + 8, z + j + 8);
+      a3 = axpy_dot4_avx (a3, y + j + 12, k, x + j + 12, z + j + 12);
+    }
+
+  _mm256_storeu_pd (acc, a0);
+  _mm256_storeu_pd (acc + 4, a1);
+  _mm256_storeu_pd (acc + 8, a2);
+  _mm256_storeu_pd (acc + 12, a3);
+}
+
+
+/*****************************************
+ *  AVX-512                              *
+ *  Partial sums k to k + 7 in the       *
+ *  register k / 8.                      *
+ *****************************************/
+
+TARGET ("avx512f")
+static void
+add_avx512 (double *x, const double *y, int n)
+{
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    _mm512_storeu_pd (x + j, _mm512_add_pd (_mm512_loadu_pd (x + j),
+					    _mm512_loadu_pd (y + j)));
+
+  add_avx (x + j, y + j, n - j);
+}
+
+TARGET ("avx512f")
+static void
+sub_avx512 (double *x, const double *y, int n)
+{
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    _mm512_storeu_pd (x + j, _mm512_sub_pd (_mm512_loadu_pd (x + j),
+					    _mm512_loadu_pd (y + j)));
+
+  sub_avx (x + j, y + j, n - j);
+}
+
+TARGET ("avx512f")
+static void
+scale_avx512 (double *x, double a, int n)
+{
+  __m512d k = _mm512_set1_pd (a);
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    _mm512_storeu_pd (x + j, _mm512_mul_pd (_mm512_loadu_pd (x + j), k));
+
+  scale_avx (x + j, a, n - j);
+}
+
+TARGET ("avx512f")
+static void
+div_avx512 (double *x, double a, int n)
+{
+  __m512d k = _mm512_set1_pd (a);
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    _mm512_storeu_pd (x + j, _mm512_div_pd (_mm512_loadu_pd (x + j), k));
+
+  div_avx (x + j, a, n - j);
+}
+
+TARGET ("avx512f")
+static void
+axpy_avx512 (double *y, double a, const double *x, int n)
+{
+  __m512d k = _mm512_set1_pd (a);
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    _mm512_storeu_pd (y + j,
+		      _mm512_add_pd (_mm512_loadu_pd (y + j),
+				     _mm512_mul_pd (k, _mm512_loadu_pd (x + j))));
+
+  axpy_avx (y + j, a, x + j, n - j);
+}
+
+TARGET ("avx512f")
+static void
+axpby_avx512 (double *y, double a, const double *x, double b, int n)
+{
+  __m512d ka = _mm512_set1_pd (a), kb = _mm512_set1_pd (b);
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    _mm512_storeu_pd (y + j,
+		      _mm512_add_pd (_mm512_mul_pd (ka, _mm512_loadu_pd (x + j)),
+				     _mm512_mul_pd (kb,
+						    _mm512_loadu_pd (y + j))));
+
+  axpby_avx (y + j, a, x + j, b, n - j);
+}
+
+TARGET ("avx512f")
+static void
+dot_avx512 (double *acc, const double *x, const double *y, int n)
+{
+  __m512d a0 = _mm512_loadu_pd (acc), a1 = _mm512_loadu_pd (acc + 8);
+  int j;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    {
+      a0 = _mm512_add_pd (a0, _mm512_mul_pd (_mm512_loadu_pd (x + j),
+					     _mm512_loadu_pd (y + j)));
+      a1 = _mm512_add_pd (a1, _mm512_mul_pd (_mm512_loadu_pd (x + j + 8),
+					     _mm512_loadu_pd (y + j + 8)));
+    }
+
+  _mm512_storeu_pd (acc, a0);
+  _mm512_storeu_pd (acc + 8, a1);
+}
+
+TARGET ("avx512f")
+static void
+sum_avx512 (double *acc, const double *x, int n, int absolute)
+{
+  __m512i m = _mm512_set1_epi64 (absolute ? 0x7fffffffffffffffLL : -1LL);
+  __m512d a0 = _mm512_loadu_pd (acc), a1 = _mm512_loadu_pd (acc + 8);
+  int j;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    {
+      __m512i x0 = _mm512_loadu_si512 (x + j);
+      __m512i x1 = _mm512_loadu_si512 (x + j + 8);
+
+      a0 = _mm512_add_pd (a0, _mm512_castsi512_pd (_mm512_and_si512 (m, x0)));
+      a1 = _mm512_add_pd (a1, _mm512_castsi512_pd (_mm512_and_si512 (m, x1)));
+    }
+
+  _mm512_storeu_pd (acc, a0);
+  _mm512_storeu_pd (acc + 8, a1);
+}
+
+/* y += k x on eight samples, then acc + y z */
+TARGET ("avx512f")
+static inline __m512d
+axpy_dot8_avx512 (__m512d acc, double *y, __m512d k, const double *x,
+		  const double *z)
+{
+  __m512d t = _mm512_add_pd (_mm512_loadu_pd (y),
+			     _mm512_mul_pd (k, _mm512_loadu_pd (x)));
+
+  _mm512_storeu_pd (y, t);
+  return (_mm512_add_pd (acc, _mm512_mul_pd (t, _mm512_loadu_pd (z))));
+}
+
+TARGET ("avx512f")
+static void
+axpy_dot_avx512 (double *acc, double *y, double a, const double *x,
+		 const double *z, int n)
+{
+  __m512d k = _mm512_set1_pd (a);
+  __m512d a0 = _mm512_loadu_pd (acc), a1 = _mm512_loadu_pd (acc + 8);
+  int j;
+
+  for (j = 0; j < n; j += BLAS_LANES)
+    {
+      a0 = axpy_dot8_avx512 (a0, y + j, k, x + j, z + j);
+      a1 = axpy_dot8_avx512 (a1, y + j + 8, k, x + j + 8, z + j + 8);
+    }
+
+  _mm512_storeu_pd (acc, a0);
+  _mm512_storeu_pd (acc + 8, a1);
+}
+
+#endif /* BLAS_X86 */
+
+
+/*****************************************
+ *  Dispatch                             *
+ *****************************************/
+
+static const blas_kernels_t blas_kernels[] = {
+  {add_c, sub_c, scale_c, div_c, axpy_c, axpby_c,
+   dot_c, sum_c, axpy_dot_c},
+#ifdef BLAS_X86
+  {add_sse2, sub_sse2, scale_sse2, div_sse2, axpy_sse2, axpby_sse2,
+   dot_sse2, sum_sse2, axpy_dot_sse2},
+  {add_avx, sub_avx, scale_avx, div_avx, axpy_avx, axpby_avx,
+   dot_avx, sum_avx, axpy_dot_avx},
+  {add_avx512, sub_avx512, scale_avx512, div_avx512, axpy_avx512, axpby_avx512,
+   dot_avx512, sum_avx512, axpy_dot_avx512},
+#endif
+};
+
+/* selected kernels; the selection on first use may be made by several
+   threads at once, which all store the same value                     */
+static const blas_kernels_t *blas = NULL;
+static int blas_selected = BLAS_C;
+static int blas_reduction = BLAS_ORDERED;
+
+static int
+blas_supported (int isa)
+{
+#ifdef BLAS_X86
+  __builtin_cpu_init ();
+
+  switch (isa)
+    {
+    case BLAS_SSE2:
+      return (__builtin_cpu_supports ("sse2"));
+    case BLAS_AVX:
+      return (__builtin_cpu_supports ("avx"));
+    case BLAS_AVX512:
+      return (__builtin_cpu_supports ("avx512f"));
+    }
+#endif
+
+  return (isa == BLAS_C);
+}
+
+int
+blas_set_isa (int isa)
+{
+  if (isa > BLAS_AVX512)
+    isa = BLAS_AVX512;
+
+  while (isa > BLAS_C && !blas_supported (isa))
+    isa--;
+
+  blas_selected = isa;
+  blas = &blas_kernels[isa];
+
+  return (isa);
+}
+
+int
+blas_isa (void)
+{
+  if (blas == NULL)
+    blas_set_isa (BLAS_AVX512);
+
+  return (blas_selected);
+}
+
+static const blas_kernels_t *
+kernels (void)
+{
+  if (blas == NULL)
+    blas_set_isa (BLAS_AVX512);
+
+  return (blas);
+}
+
+void
+blas_set_mode (int mode)
+{
+  blas_reduction = mode;
+}
+
+int
+blas_mode (void)
+{
+  return (blas_reduction);
+}
+
+
+/*****************************************
+ *  Interface                            *
+ *****************************************/
+
+void
+blas_add (double *x, const double *y, int n)
+{
+  kernels ()->add (x, y, n);
+}
+
+void
+blas_sub (double *x, const double *y, int n)
+{
+  kernels ()->sub (x, y, n);
+}
+
+void
+blas_scale (double *x, double a, int n)
+{
+  kernels ()->scale (x, a, n);
+}
+
+void
+blas_div (double *x, double a, int n)
+{
+  kernels ()->div (x, a, n);
+}
+
+void
+blas_axpy (double *y, double a, const double *x, int n)
+{
+  kernels ()->axpy (y, a, x, n);
+}
+
+void
+blas_axpby (double *y, double a, const double *x, double b, int n)
+{
+  kernels ()->axpby (y, a, x, b, n);
+}
+
+/* sum of the partial sums, by halves */
+static double
+blas_fold (double *acc)
+{
+  int h, k;
+
+  for (h = BLAS_LANES / 2; h > 0; h >>= 1)
+    for (k = 0; k < h; k++)
+      acc[k] += acc[k + h];
+
+  return (acc[0]);
+}
+
+double
+blas_dot (const double *x, const double *y, int n)
+{
+  double acc[BLAS_LANES] = { 0 };
+  double p = 0;
+  int j = 0;
+
+  if (blas_reduction == BLAS_BLOCKED)
+    {
+      j = n - n % BLAS_LANES;
+      kernels ()->dot (acc, x, y, j);
+      p = blas_fold (acc);
+    }
+
+  for (; j < n; j++)
+    p += x[j] * y[j];
+
+  return (p);
+}
+
+double
+blas_sum (const double *x, int n)
+{
+  double acc[BLAS_LANES] = { 0 };
+  double s = 0;
+  int j = 0;
+
+  if (blas_reduction == BLAS_BLOCKED)
+    {
+      j = n - n % BLAS_LANES;
+      kernels ()->sum (acc, x, j, 0);
+      s = blas_fold (acc);
+    }
+
+  for (; j < n; j++)
+    s += x[j];
+
+  return (s);
+}
+
+double
+blas_asum (const double *x, int n)
+{
+  double acc[BLAS_LANES] = { 0 };
+  double s = 0;
+  int j = 0;
+
+  if (blas_reduction == BLAS_BLOCKED)
+    {
+      j = n - n % BLAS_LANES;
+      kernels ()->sum (acc, x, j, 1);
+      s = blas_fold (acc);
+    }
+
+  for (; j < n; j++)
+    s += fabs (x[j]);
+
+  return (s);
+}
+
+double
+blas_sum_sqr (const double *x, int n)
+{
+  return (blas_dot (x, x, n));
+}
+
+double
+blas_axpy_dot (double *y, double a, const double *x, const double *z, int n)
+{
+  double acc[BLAS_LANES] = { 0 };
+  double p = 0;
+  int j = 0;
+
+  if (blas_reduction == BLAS_BLOCKED)
+    {
+      j = n - n % BLAS_LANES;
+      kernels ()->axpy_dot (acc, y, a, x, z, j);
+      p = blas_fold (acc);
+    }
+
+  for (; j < n; j++)
+    {
+      y[j] += a * x[j];
+      p += y[j] * z[j];
+    }
+
+  return (p);
+}
+
+
+/*****************************************
+ *  Benchmark                            *
+ *****************************************/
+
+#define BLAS_BENCH_KERNELS 11
+
+static double
+blas_bench_run (int kernel, double *x, const double *y, int n)
+{
+  switch (kernel)
+    {
+    case 0:
+      blas_add (x, y, n);
+      break;
+    case 1:
+      blas_sub (x, y, n);
+      break;
+    case 2:
+      blas_scale (x, 1.0, n);
+      break;
+    case 3:
+      blas_div (x, 1.0, n);
+      break;
+    case 4:
+      return (blas_dot (x, y, n));
+    case 5:
+      return (blas_sum (x, n));
+    case 6:
+      return (blas_asum (x, n));
+    case 7:
+      return (blas_sum_sqr (x, n));
+    case 8:
+      blas_axpy (x, 1.0, y, n);
+      break;
+    case 9:
+      blas_axpby (x, 1.0, y, 0.5, n);
+      break;
+    case 10:
+      return (blas_axpy_dot (x, -1.0, y, y, n));
+    }
+
+  return (x[0]);
+}
+
+void
+blas_benchmark (int n, int repeat)
+{
+  static const char *names[] = { "C", "SSE2", "AVX", "AVX-512" };
+  int isa = blas_isa (), mode = blas_mode ();
+  double *x = (double *) malloc (sizeof (double) * n);
+  double *y = (double *) malloc (sizeof (double) * n);
+  volatile double sink = 0;
+  clock_t start;
+  int i, m, k, r, j;
+
+  for (j = 0; j < n; j++)
+    {
+      x[j] = (j % 17) - 8.5;
+      y[j] = (j % 13) * 0.25;
+    }
+
+  printf ("blas: %d samples, %d runs, ns per sample\n", n, repeat);
+  printf ("%-8s %-8s %7s %7s %7s %7s %7s %7s %7s %7s %7s %7s %7s\n",
+	  "isa", "mode", "add", "sub", "scale", "div", "dot", "sum", "asum",
+	  "sum_sqr", "axpy", "axpby", "axpydot");
+
+  for (i = BLAS_C; i <= BLAS_AVX512; i++)
+    {
+      if (blas_set_isa (i) != i)
+	continue;
+
+      for (m = BLAS_ORDERED; m <= BLAS_BLOCKED; m++)
+	{
+	  blas_set_mode (m);
+	  printf ("%-8s %-8s", names[i],
+		  (m == BLAS_ORDERED) ? "ordered" : "blocked");
+
+	  for (k = 0; k < BLAS_BENCH_KERNELS; k++)
+	    {
+	      start = clock ();
+	      for (r = 0; r < repeat; r++)
+		sink += blas_bench_run (k, x, y, n);
+	      printf (" %7.3f", 1e9 * (clock () - start) / CLOCKS_PER_SEC
+		      / ((double) n * repeat));
+	    }
+	  printf ("\n");
+	}
+    }
+
+  blas_set_isa (isa);
+  blas_set_mode (mode);
+  free (x);
+  free (y);
+}
@@ -0,0 +1,319 @@
+/*
+  On-disk carrier cache.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <process.h>
+#define getpid _getpid
+#endif
+
+#include "../include/vec.h"
+#include "../include/io.h"
+#include "../include/cache.h"
+
+#define CACHE_MAGIC "QIMCARR"
+#define CACHE_BLOCK 64
+
+/* first block of a cache file */
+typedef struct _cache_header_
+{
+  char magic[8];
+  unsigned int version;
+  unsigned int generator;
+  unsigned int key[4];
+  int layer;
+  int dim;
+  int nb_bits;
+  unsigned int vec_header_size;
+  unsigned int record_size;
+  int type;
+  unsigned int element_size;
+} cache_header_t;
+
+/* bytes of a sample of the carriers of the generator */
+static size_t
+cache_element_size (unsigned int generator)
+{
+  switch (CACHE_GEN_TYPE_OF (generator))
+    {
+    case QIM_F32:
+      return (sizeof (float));
+    case QIM_I8:
+      return (sizeof (signed char));
+    default:
+      return (sizeof (double));
+    }
+}
+
+/* bytes used by a carrier: header block, then samples up to a block */
+static size_t
+cache_record_size (int dim, unsigned int generator)
+{
+  size_t data = cache_element_size (generator) * dim;
+
+  return (CACHE_BLOCK + (data + CACHE_BLOCK - 1) / CACHE_BLOCK * CACHE_BLOCK);
+}
+
+static void
+cache_name (char *name, size_t size, const char *dir,
+	    unsigned int const key[4], int layer, int dim, int nb_bits,
+	    unsigned int generator)
+{
+  snprintf (name, size, "%s/carriers_%08x%08x%08x%08x_%d_%d_%d_%x.qc", dir,
+	    key[0], key[1], key[2], key[3], layer, dim, nb_bits, generator);
+}
+
+static void
+cache_header (cache_header_t * h, unsigned int const key[4], int layer,
+	      int dim, int nb_bits, unsigned int generator)
+{
+  memset (h, 0, sizeof (cache_header_t));
+  memcpy (h->magic, CACHE_MAGIC, sizeof (CACHE_MAGIC));
+  h->version = CACHE_VERSION;
+  h->generator = generator;
+  memcpy (h->key, key, sizeof (h->key));
+  h->layer = layer;
+  h->dim = dim;
+  h->nb_bits = nb_bits;
+  h->vec_header_size = sizeof (Vec_header_t);
+  h->record_size = cache_record_size (dim, generator);
+  h->type = CACHE_GEN_TYPE_OF (generator);
+  h->element_size = cache_element_size (generator);
+}
+
+
+/*****************************************
+ *  Reading                              *
+ *****************************************/
+
+carrier_cache_t *
+carrier_cache_open (const char *dir, unsigned int const key[4], int layer,
+		    int dim, int nb_bits, unsigned int generator)
+{
+  char name[1024];
+  cache_header_t expected;
+  size_t size = CACHE_BLOCK + nb_bits * cache_record_size (dim, generator);
+  carrier_cache_t *cache;
+  qim_packed_t *p = NULL;
+  char *base, *record;
+  int i;
+
+  cache_name (name, sizeof (name), dir, key, layer, dim, nb_bits, generator);
+  cache_header (&expected, key, layer, dim, nb_bits, generator);
+
+#ifndef WIN32
+  {
+    struct stat st;
+    int fd = open (name, O_RDONLY);
+
+    if (fd < 0)
+      return (NULL);
+    if (fstat (fd, &st) || (size_t) st.st_size != size)
+      {
+	close (fd);
+	return (NULL);
+      }
+
+    base = (char *) mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (base == (char *) MAP_FAILED)
+      return (NULL);
+
+    if (memcmp (base, &expected, sizeof (cache_header_t)))
+      {
+	munmap (base, size);
+	return (NULL);
+      }
+  }
+#else
+  {
+    FILE *f = fopen (name, "rb");
+
+    if (f == NULL)
+      return (NULL);
+
+    base = (char *) malloc (size);
+    if (fread (base, 1, size, f) != size
+	|| fgetc (f) != EOF
+	|| memcmp (base, &expected, sizeof (cache_header_t)))
+      {
+	free (base);
+	fclose (f);
+	return (NULL);
+      }
+    fclose (f);
+  }
+#endif
+
+  cache = (carrier_cache_t *) malloc (sizeof (carrier_cache_t));
+  cache->carriers = NULL;
+  cache->packed = NULL;
+  cache->type = expected.type;
+  cache->nb_bits = nb_bits;
+  cache->dim = dim;
+  cache->base = base;
+  cache->size = size;
+#ifndef WIN32
+  cache->mapped = 1;
+#else
+  cache->mapped = 0;
+#endif
+
+  if (cache->type == QIM_F64)
+    cache->carriers = (vec *) malloc (sizeof (vec) * (nb_bits + 1));
+  else
+    {
+      p = cache->packed = (qim_packed_t *) malloc (sizeof (qim_packed_t));
+      p->type = cache->type;
+      p->nb_bits = nb_bits;
+      p->dim = dim;
+      p->data = (void **) malloc (sizeof (void *) * (nb_bits + 1));
+      p->scale = (double *) malloc (sizeof (double) * (nb_bits + 1));
+    }
+
+  for (i = 0; i < nb_bits; i++)
+    {
+      record = base + CACHE_BLOCK + (size_t) i * expected.record_size;
+
+      if (cache->carriers)
+	cache->carriers[i] = (vec) (record + CACHE_BLOCK);
+      else
+	{
+	  p->data[i] = record + CACHE_BLOCK;
+	  memcpy (p->scale + i, record, sizeof (double));
+	}
+    }
+
+  return (cache);
+}
+
+void
+carrier_cache_close (carrier_cache_t * cache)
+{
+#ifndef WIN32
+  if (cache->mapped)
+    munmap (cache->base, cache->size);
+  else
+#endif
+    free (cache->base);
+
+  if (cache->packed)
+    {
+      free (cache->packed->scale);
+      free (cache->packed->data);
+      free (cache->packed);
+    }
+  free (cache->carriers);
+  free (cache);
+}
+
+
+/*****************************************
+ *  Writing                              *
+ *  The file is written under a name    *
+ *  of the process then renamed, so that *
+ *  a reader never sees it partially     *
+ *  written and two processes writing    *
+ *  the same file do not mix their data. *
+ *****************************************/
+
+/* data[i] holds the dim samples of carrier i, scale[i] its step if any */
+static int
+cache_write (const char *dir, unsigned int const key[4], int layer,
+	     int dim, int nb_bits, unsigned int generator,
+	     void *const *data, const double *scale)
+{
+  char name[1024], tmp[1060];
+  char block[CACHE_BLOCK];
+  cache_header_t h;
+  Vec_header_t vh;
+  size_t element_size = cache_element_size (generator);
+  size_t pad = cache_record_size (dim, generator) - CACHE_BLOCK
+    - element_size * dim;
+  FILE *f;
+  int i, ok = 1;
+
+  cache_name (name, sizeof (name), dir, key, layer, dim, nb_bits, generator);
+  snprintf (tmp, sizeof (tmp), "%s.%ld.tmp", name, (long) getpid ());
+
+  f = fopen (tmp, "wb");
+  if (f == NULL)
+    {
+      it_warning ("cache: unable to write %s\n", tmp);
+      return (0);
+    }
+
+  memset (block, 0, CACHE_BLOCK);
+  cache_header (&h, key, layer, dim, nb_bits, generator);
+  memcpy (block, &h, sizeof (h));
+  ok &= fwrite (block, CACHE_BLOCK, 1, f) == 1;
+
+  /* header of the mapped vectors, which are never freed */
+  vh.length = dim;
+  vh.length_max = dim;
+  vh.ptr = NULL;
+  vh.element_size = element_size;
+
+  for (i = 0; i < nb_bits && ok; i++)
+    {
+      memset (block, 0, CACHE_BLOCK);
+      if (scale)
+	memcpy (block, scale + i, sizeof (double));
+      memcpy (block + CACHE_BLOCK - sizeof (vh), &vh, sizeof (vh));
+      ok &= fwrite (block, CACHE_BLOCK, 1, f) == 1;
+      ok &= fwrite (data[i], element_size, dim, f) == (size_t) dim;
+
+      memset (block, 0, CACHE_BLOCK);
+      ok &= fwrite (block, 1, pad, f) == pad;
+    }
+
+  ok &= fclose (f) == 0;
+
+#ifdef WIN32
+  remove (name);
+#endif
+  if (!ok || rename (tmp, name))
+    {
+      it_warning ("cache: unable to write %s\n", name);
+      remove (tmp);
+      return (0);
+    }
+
+  return (1);
+}
+
+int
+carrier_cache_write (const char *dir, unsigned int const key[4], int layer,
+		     int dim, int nb_bits, unsigned int generator,
+		     vec * carriers)
+{
+  int i;
+
+  it_assert (CACHE_GEN_TYPE_OF (generator) == QIM_F64,
+	     "cache: carriers in double for a compact type");
+  for (i = 0; i < nb_bits; i++)
+    assert (vec_length (carriers[i]) == dim);
+
+  return (cache_write (dir, key, layer, dim, nb_bits, generator,
+		       (void *const *) carriers, NULL));
+}
+
+int
+carrier_cache_write_packed (const char *dir, unsigned int const key[4],
+			    int layer, unsigned int generator,
+			    qim_packed_t * p)
+{
+  it_assert (CACHE_GEN_TYPE_OF (generator) == (unsigned int) p->type,
+	     "cache: carriers of another type than the generator");
+
+  return (cache_write (dir, key, layer, p->dim, p->nb_bits, generator,
+		       p->data, p->scale));
+}
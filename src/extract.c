@@ -38,8 +38,12 @@ knowledge of the CeCILL license and that you accept its terms.
 
 */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "../include/vec.h"
 #include "../include/mat.h"
+#include "../include/io.h"
 #include "../include/wavelet2D.h"
 
 #include "../include/extract.h"
@@ -48,101 +52,121 @@ knowledge of the CeCILL license and that you accept its terms.
 int
 extract (mat Wav_X, vec s_X_LL, vec s_X, int levels)
 {
-  int i, j, k, l, m;
+  return (extract_view (mat_get_view (Wav_X), s_X_LL, s_X, levels));
+}
 
-  /* Image subbands */
-  mat *subx = it_wavelet2D_split (Wav_X, levels);
+int
+extract_view (mat_view Wav_X, vec s_X_LL, vec s_X, int levels)
+{
+  int k, l, m;
 
-  k = 0;
-  for (l = levels; l > 0; l--)
-    for (m = 2; m >= 0; m--)
-      for (i = 0; i < mat_height (subx[l * 3 - m]); i++)
-	for (j = 0; j < mat_width (subx[l * 3 - m]); j++)
-	  {
-	    s_X[k] = subx[l * 3 - m][i][j];
-	    k++;
-	  }
-  k = 0;
+  /* Image subbands, in place */
+  mat_view *subx = (mat_view *) malloc (sizeof (mat_view) * (3 * levels + 1));
+  it_wavelet2D_split_view (Wav_X, levels, subx);
 
-  for (i = 0; i < mat_height (subx[0]); i++)
-    for (j = 0; j < mat_width (subx[0]); j++)
-      {
-	s_X_LL[k] = subx[0][i][j];
-	k++;
-      }
+  /* either vector may be NULL when not needed */
+  k = 0;
+  if (s_X)
+    for (l = levels; l > 0; l--)
+      for (m = 2; m >= 0; m--)
+	k = mat_view_to_vec (subx[l * 3 - m], s_X, k);
 
-  /* Cleaning */
-  for (l = levels; l > 0; l--)
-    {
-      mat_delete (subx[3 * l - 2]);
-      mat_delete (subx[3 * l - 1]);
-      mat_delete (subx[3 * l]);
-    }
-  mat_delete (subx[0]);
+  if (s_X_LL)
+    mat_view_to_vec (subx[0], s_X_LL, 0);
 
+  free (subx);
   return (1);
 }
 
 int
 extractInv (vec s_X_LL, vec s_X, int levels, int h_I, int w_I, mat Mwav)
 {
-  int i, j, k, l, m;
-  mat *subx = NULL;
-  mat MwavRet;
-  int mid_row, mid_col;
-
-  /* Image subbands */
-  subx = (mat *) malloc (sizeof (mat) * (3 * levels + 1));
-  mid_row = (w_I) / 2;
-  mid_col = (h_I) / 2;
+  assert (mat_height (Mwav) == h_I && mat_width (Mwav) == w_I);
+  return (extractInv_view (s_X_LL, s_X, levels, mat_get_view (Mwav)));
+}
 
-  for (l = levels; l > 0; l--)
-    {
-      subx[l * 3 - 2] = mat_new_zeros (mid_col, mid_row);
-      subx[l * 3 - 1] = mat_new_zeros (mid_col, mid_row);
-      subx[l * 3] = mat_new_zeros (mid_col, mid_row);
-      h_I = mid_row;
-      w_I = mid_col;
-      mid_row = (h_I) / 2;
-      mid_col = (w_I) / 2;
-    }
+int
+extractInv_view (vec s_X_LL, vec s_X, int levels, mat_view Mwav)
+{
+  int k, l, m;
 
-  subx[0] = mat_new_zeros (w_I, h_I);
+  /* Image subbands, in place */
+  mat_view *subx = (mat_view *) malloc (sizeof (mat_view) * (3 * levels + 1));
+  it_wavelet2D_split_view (Mwav, levels, subx);
 
   k = 0;
-  for (l = levels; l > 0; l--)
-    for (m = 2; m >= 0; m--)
-      for (i = 0; i < mat_height (subx[l * 3 - m]); i++)
-	for (j = 0; j < mat_width (subx[l * 3 - m]); j++)
-	  {
-	    subx[l * 3 - m][i][j] = s_X[k];
-	    k++;
-	  }
+  if (s_X)
+    for (l = levels; l > 0; l--)
+      for (m = 2; m >= 0; m--)
+	k = vec_to_mat_view (s_X, k, subx[l * 3 - m]);
 
-  k = 0;
-  for (i = 0; i < mat_height (subx[0]); i++)
-    for (j = 0; j < mat_width (subx[0]); j++)
-      {
-	subx[0][i][j] = s_X_LL[k];
-	k++;
-      }
+  if (s_X_LL)
+    vec_to_mat_view (s_X_LL, 0, subx[0]);
 
-  /* Merge subx */
-  MwavRet = it_wavelet2D_merge (subx, levels);
+  free (subx);
+  return (1);
+}
 
-  mat_copy (Mwav, MwavRet);
+/* Rows of the first level given out by the stream of extract_pgm_HF:
+   each band goes at its offset in V_X, HL then LH then HH.            */
+typedef struct
+{
+  vec V_X;
+  int offset[4];
+} extract_stream_t;
 
-  /* Cleaning */
-  mat_delete (MwavRet);
-  for (l = levels; l > 0; l--)
+static void
+extract_stream_emit (void *arg, int level, int band, int row,
+		     double const *samples, int width)
+{
+  extract_stream_t *e = (extract_stream_t *) arg;
+
+  if (level != 0 || band == IT_WAVELET2D_LL)
+    return;
+  memcpy (e->V_X + e->offset[band] + row * width, samples,
+	  sizeof (double) * width);
+}
+
+vec
+extract_pgm_HF (const char *filename, it_wavelet_lifting_t const *lifting,
+		int *width, int *height)
+{
+  it_wavelet2D_stream_t *stream;
+  extract_stream_t e;
+  vec line;
+  FILE *F;
+  int w, h, y;
+
+  if (!(F = pgm_read_open (filename, &w, &h)))
+    return (NULL);
+
+  /* the bands of the first level, as laid out by it_wavelet2D_split */
+  e.offset[IT_WAVELET2D_HL] = 0;
+  e.offset[IT_WAVELET2D_LH] = ((h + 1) / 2) * (w / 2);
+  e.offset[IT_WAVELET2D_HH] = e.offset[IT_WAVELET2D_LH] + (h / 2) * ((w + 1) / 2);
+  e.V_X = vec_new (w * h - ((h + 1) / 2) * ((w + 1) / 2));
+
+  line = vec_new (w);
+  stream = it_wavelet2D_stream_new (lifting, 1, w, h, extract_stream_emit, &e);
+  for (y = 0; y < h; y++)
     {
-      mat_delete (subx[3 * l - 2]);
-      mat_delete (subx[3 * l - 1]);
-      mat_delete (subx[3 * l]);
+      if (!vec_pgm_read_line (F, line))
+	break;
+      it_wavelet2D_stream_push (stream, line);
     }
-  mat_delete (subx[0]);
+  it_wavelet2D_stream_delete (stream);
+  vec_delete (line);
+  fclose (F);
 
-  return (1);
+  if (y < h)
+    {
+      vec_delete (e.V_X);
+      return (NULL);
+    }
+
+  *width = w;
+  *height = h;
+  return (e.V_X);
 }
 
 int
@@ -506,6 +506,7 @@ char * it_read_double( char * s, double * p_val )
     it_error( "Unable to read a double in string %s\n", s );
 
   buf = (char*) malloc( nb_char_number + 1 ); 
+  Vec_alloc_account( nb_char_number + 1 );
   buf[ nb_char_number ] = '\0';
   strncpy( buf, s, nb_char_number );
   
@@ -550,6 +551,7 @@ char * it_read_cplx( char * s, cplx * p_val )
 
   if( s[ nb_char_not_delim ] != 'i' ) { /* It is the real part*/
     buf = (char*) malloc( nb_char_number + 1 ); 
+    Vec_alloc_account( nb_char_number + 1 );
     buf[ nb_char_number ] = '\0';
     strncpy( buf, s, nb_char_number );
     sscanf( buf, "%lf", &( creal( *p_val ) ) );
@@ -564,6 +566,7 @@ char * it_read_cplx( char * s, cplx * p_val )
 
   if( s[ nb_char_not_delim ] == 'i' ) { /* It is the complex part */
     buf = (char*) malloc( nb_char_number + 1 ); 
+    Vec_alloc_account( nb_char_number + 1 );
     buf[ nb_char_number ] = '\0';
     strncpy( buf, s, nb_char_number );
     r = sscanf( buf, "%lf", &( cimag( *p_val ) ) );
@@ -596,6 +599,7 @@ char * it_read_int( char * s, int * p_val )
     it_error( "Bad integer numbers in string %s\n", s );
 
   buf = (char*) malloc( nb_char_number + 1 ); 
+  Vec_alloc_account( nb_char_number + 1 );
   buf[ nb_char_number ] = '\0';
   strncpy( buf, s, nb_char_number );
   
@@ -1239,6 +1243,77 @@ int imat_pgm_write( const char* filename, imat m )
 }
 
 
+
+/*----------------------------------------------------------------------*/
+/* Read a pgm file line by line                                         */
+FILE * pgm_read_open( const char* filename, int * p_width, int * p_height )
+{
+  FILE * F = fopen( filename, "rb" );
+  char type;
+  int max_val;
+
+  if( !F ) {
+    it_printf( "Unable to open file %s\n", filename );
+    return NULL;
+  }
+
+  if( !pnm_read_header( F, &type, p_width, p_height, &max_val, NULL, 0 ) ) {
+    fclose( F );
+    return NULL;
+  }
+
+  return F;
+}
+
+
+/*----------------------------------------------------------------------*/
+int vec_pgm_read_line( FILE * F, vec v )
+{
+  idx_t j;
+  int c;
+
+  for( j = 0 ; j < vec_length( v ) ; j++ ) {
+    if( ( c = getc( F ) ) == EOF )
+      return 0;
+    v[j] = (double) c;
+  }
+
+  return 1;
+}
+
+
+/*----------------------------------------------------------------------*/
+/* Write a pgm file line by line                                        */
+FILE * pgm_write_open( const char* filename, int width, int height )
+{
+  FILE * F = fopen( filename, "w+b" );
+
+  if( !F ) {
+    it_printf( "Unable to open file %s\n", filename );
+    return NULL;
+  }
+
+  pnm_write_header( F, '5', width, height, 255, "Generated by libit" );
+  return F;
+}
+
+
+/*----------------------------------------------------------------------*/
+int vec_pgm_write_line( FILE * F, vec v )
+{
+  idx_t j;
+  double x;
+
+  for( j = 0 ; j < vec_length( v ) ; j++ ) {
+    x = v[j] + 0.5;
+    if(x < 0) x = 0;
+    if(x > 255) x = 255;
+    putc( (int) x, F );
+  }
+
+  return !ferror( F );
+}
+
 /*---------------------------------------------------------------------*/
 /*   WAV related functions                                             */
 /*---------------------------------------------------------------------*/
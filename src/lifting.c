@@ -0,0 +1,709 @@
+/*
+  Vector kernels of the lifting wavelet transforms.
+*/
+
+#include <stddef.h>
+
+#include "../include/lifting.h"
+
+/* a multiply-add must not be fused, whatever the instruction set */
+#ifdef __GNUC__
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define LIFTING_X86
+#include <immintrin.h>
+#define TARGET(isa) __attribute__ ((target (isa)))
+#endif
+
+typedef struct _lifting_kernels_
+{
+  void (*step) (double *d, const double *s, const double *a,
+		const double *b, double c, int n);
+  void (*scale) (double *d, double c, int n);
+  void (*split) (double *even, double *odd, const double *x, int n);
+  void (*merge) (double *x, const double *even, const double *odd, int n);
+  void (*istep) (int *d, const int *s, const int *a, const int *b, int add,
+		 int shift, int sign, int n);
+  void (*fstep) (float *d, const float *s, const float *a, const float *b,
+		 float c, int n);
+  void (*fscale) (float *d, float c, int n);
+} lifting_kernels_t;
+
+
+/*****************************************
+ *  Plain C                              *
+ *  Also used for the tails of the       *
+ *  vector kernels.                      *
+ *****************************************/
+
+static void
+step_c (double *d, const double *s, const double *a, const double *b,
+	double c, int n)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+    d[j] = s[j] + c * (a[j] + b[j]);
+}
+
+static void
+scale_c (double *d, double c, int n)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+    d[j] *= c;
+}
+
+static void
+split_c (double *even, double *odd, const double *x, int n)
+{
+  int j;
+
+  for (j = 0; j + 1 < n; j += 2)
+    {
+      even[j >> 1] = x[j];
+      odd[j >> 1] = x[j + 1];
+    }
+  if (j < n)
+    even[j >> 1] = x[j];
+}
+
+static void
+merge_c (double *x, const double *even, const double *odd, int n)
+{
+  int j;
+
+  for (j = 0; j + 1 < n; j += 2)
+    {
+      x[j] = even[j >> 1];
+      x[j + 1] = odd[j >> 1];
+    }
+  if (j < n)
+    x[j] = even[j >> 1];
+}
+
+/* single precision */
+static void
+fstep_c (float *d, const float *s, const float *a, const float *b,
+	 float c, int n)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+    d[j] = s[j] + c * (a[j] + b[j]);
+}
+
+static void
+fscale_c (float *d, float c, int n)
+{
+  int j;
+
+  for (j = 0; j < n; j++)
+    d[j] *= c;
+}
+
+/* steps of the reversible 5/3, on integers */
+static void
+istep_c (int *d, const int *s, const int *a, const int *b, int add,
+	 int shift, int sign, int n)
+{
+  int j;
+
+  if (sign > 0)
+    for (j = 0; j < n; j++)
+      d[j] = s[j] + ((a[j] + b[j] + add) >> shift);
+  else
+    for (j = 0; j < n; j++)
+      d[j] = s[j] - ((a[j] + b[j] + add) >> shift);
+}
+
+#ifdef LIFTING_X86
+
+/*****************************************
+ *  SSE2                                 *
+ *****************************************/
+
+TARGET ("sse2")
+static void
+fstep_sse2 (float *d, const float *s, const float *a, const float *b,
+	   float c, int n)
+{
+  __m128 k = _mm_set1_ps (c);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    {
+      __m128 t = _mm_add_ps (_mm_loadu_ps (a + j),
+			     _mm_loadu_ps (b + j));
+
+      _mm_storeu_ps (d + j, _mm_add_ps (_mm_loadu_ps (s + j),
+					_mm_mul_ps (k, t)));
+    }
+
+  fstep_c (d + j, s + j, a + j, b + j, c, n - j);
+}
+
+TARGET ("sse2")
+static void
+fscale_sse2 (float *d, float c, int n)
+{
+  __m128 k = _mm_set1_ps (c);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    _mm_storeu_ps (d + j, _mm_mul_ps (_mm_loadu_ps (d + j), k));
+
+  fscale_c (d + j, c, n - j);
+}
+
+TARGET ("sse2")
+static void
+istep_sse2 (int *d, const int *s, const int *a, const int *b, int add,
+	    int shift, int sign, int n)
+{
+  __m128i k = _mm_set1_epi32 (add);
+  __m128i c = _mm_cvtsi32_si128 (shift);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    {
+      __m128i t = _mm_add_epi32 (_mm_loadu_si128 ((__m128i *) (a + j)),
+				 _mm_loadu_si128 ((__m128i *) (b + j)));
+      __m128i x = _mm_loadu_si128 ((__m128i *) (s + j));
+
+      t = _mm_sra_epi32 (_mm_add_epi32 (t, k), c);
+      x = (sign > 0) ? _mm_add_epi32 (x, t) : _mm_sub_epi32 (x, t);
+      _mm_storeu_si128 ((__m128i *) (d + j), x);
+    }
+
+  istep_c (d + j, s + j, a + j, b + j, add, shift, sign, n - j);
+}
+
+TARGET ("sse2")
+static void
+step_sse2 (double *d, const double *s, const double *a, const double *b,
+	   double c, int n)
+{
+  __m128d k = _mm_set1_pd (c);
+  int j;
+
+  for (j = 0; j + 2 <= n; j += 2)
+    {
+      __m128d t = _mm_add_pd (_mm_loadu_pd (a + j), _mm_loadu_pd (b + j));
+
+      _mm_storeu_pd (d + j, _mm_add_pd (_mm_loadu_pd (s + j),
+					_mm_mul_pd (k, t)));
+    }
+
+  step_c (d + j, s + j, a + j, b + j, c, n - j);
+}
+
+TARGET ("sse2")
+static void
+scale_sse2 (double *d, double c, int n)
+{
+  __m128d k = _mm_set1_pd (c);
+  int j;
+
+  for (j = 0; j + 2 <= n; j += 2)
+    _mm_storeu_pd (d + j, _mm_mul_pd (_mm_loadu_pd (d + j), k));
+
+  scale_c (d + j, c, n - j);
+}
+
+TARGET ("sse2")
+static void
+split_sse2 (double *even, double *odd, const double *x, int n)
+{
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    {
+      __m128d x0 = _mm_loadu_pd (x + j);
+      __m128d x1 = _mm_loadu_pd (x + j + 2);
+
+      _mm_storeu_pd (even + (j >> 1), _mm_unpacklo_pd (x0, x1));
+      _mm_storeu_pd (odd + (j >> 1), _mm_unpackhi_pd (x0, x1));
+    }
+
+  split_c (even + (j >> 1), odd + (j >> 1), x + j, n - j);
+}
+
+TARGET ("sse2")
+static void
+merge_sse2 (double *x, const double *even, const double *odd, int n)
+{
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    {
+      __m128d e = _mm_loadu_pd (even + (j >> 1));
+      __m128d o = _mm_loadu_pd (odd + (j >> 1));
+
+      _mm_storeu_pd (x + j, _mm_unpacklo_pd (e, o));
+      _mm_storeu_pd (x + j + 2, _mm_unpackhi_pd (e, o));
+    }
+
+  merge_c (x + j, even + (j >> 1), odd + (j >> 1), n - j);
+}
+
+
+/*****************************************
+ *  AVX                                  *
+ *****************************************/
+
+TARGET ("avx")
+static void
+step_avx (double *d, const double *s, const double *a, const double *b,
+	  double c, int n)
+{
+  __m256d k = _mm256_set1_pd (c);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    {
+      __m256d t = _mm256_add_pd (_mm256_loadu_pd (a + j),
+				 _mm256_loadu_pd (b + j));
+
+      _mm256_storeu_pd (d + j, _mm256_add_pd (_mm256_loadu_pd (s + j),
+					      _mm256_mul_pd (k, t)));
+    }
+
+  step_c (d + j, s + j, a + j, b + j, c, n - j);
+}
+
+TARGET ("avx")
+static void
+fstep_avx (float *d, const float *s, const float *a, const float *b,
+	  float c, int n)
+{
+  __m256 k = _mm256_set1_ps (c);
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    {
+      __m256 t = _mm256_add_ps (_mm256_loadu_ps (a + j),
+				_mm256_loadu_ps (b + j));
+
+      _mm256_storeu_ps (d + j, _mm256_add_ps (_mm256_loadu_ps (s + j),
+					      _mm256_mul_ps (k, t)));
+    }
+
+  fstep_c (d + j, s + j, a + j, b + j, c, n - j);
+}
+
+TARGET ("avx")
+static void
+fscale_avx (float *d, float c, int n)
+{
+  __m256 k = _mm256_set1_ps (c);
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    _mm256_storeu_ps (d + j, _mm256_mul_ps (_mm256_loadu_ps (d + j), k));
+
+  fscale_c (d + j, c, n - j);
+}
+
+TARGET ("avx2")
+static void
+istep_avx2 (int *d, const int *s, const int *a, const int *b, int add,
+	    int shift, int sign, int n)
+{
+  __m256i k = _mm256_set1_epi32 (add);
+  __m128i c = _mm_cvtsi32_si128 (shift);
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    {
+      __m256i t = _mm256_add_epi32 (_mm256_loadu_si256 ((__m256i *) (a + j)),
+				    _mm256_loadu_si256 ((__m256i *) (b + j)));
+      __m256i x = _mm256_loadu_si256 ((__m256i *) (s + j));
+
+      t = _mm256_sra_epi32 (_mm256_add_epi32 (t, k), c);
+      x = (sign > 0) ? _mm256_add_epi32 (x, t) : _mm256_sub_epi32 (x, t);
+      _mm256_storeu_si256 ((__m256i *) (d + j), x);
+    }
+
+  istep_sse2 (d + j, s + j, a + j, b + j, add, shift, sign, n - j);
+}
+
+TARGET ("avx")
+static void
+scale_avx (double *d, double c, int n)
+{
+  __m256d k = _mm256_set1_pd (c);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    _mm256_storeu_pd (d + j, _mm256_mul_pd (_mm256_loadu_pd (d + j), k));
+
+  scale_c (d + j, c, n - j);
+}
+
+TARGET ("avx")
+static void
+split_avx (double *even, double *odd, const double *x, int n)
+{
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    {
+      __m256d x0 = _mm256_loadu_pd (x + j);	/* x0 x1 x2 x3 */
+      __m256d x1 = _mm256_loadu_pd (x + j + 4);	/* x4 x5 x6 x7 */
+      __m256d lo = _mm256_permute2f128_pd (x0, x1, 0x20);	/* x0 x1 x4 x5 */
+      __m256d hi = _mm256_permute2f128_pd (x0, x1, 0x31);	/* x2 x3 x6 x7 */
+
+      _mm256_storeu_pd (even + (j >> 1), _mm256_unpacklo_pd (lo, hi));
+      _mm256_storeu_pd (odd + (j >> 1), _mm256_unpackhi_pd (lo, hi));
+    }
+
+  split_sse2 (even + (j >> 1), odd + (j >> 1), x + j, n - j);
+}
+
+TARGET ("avx")
+static void
+merge_avx (double *x, const double *even, const double *odd, int n)
+{
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    {
+      __m256d e = _mm256_loadu_pd (even + (j >> 1));
+      __m256d o = _mm256_loadu_pd (odd + (j >> 1));
+      __m256d lo = _mm256_unpacklo_pd (e, o);	/* e0 o0 e2 o2 */
+      __m256d hi = _mm256_unpackhi_pd (e, o);	/* e1 o1 e3 o3 */
+
+      _mm256_storeu_pd (x + j, _mm256_permute2f128_pd (lo, hi, 0x20));
+      _mm256_storeu_pd (x + j + 4, _mm256_permute2f128_pd (lo, hi, 0x31));
+    }
+
+  merge_sse2 (x + j, even + (j >> 1), odd + (j >> 1), n - j);
+}
+
+
+/*****************************************
+ *  AVX-512                              *
+ *****************************************/
+
+TARGET ("avx512f")
+static void
+step_avx512 (double *d, const double *s, const double *a, const double *b,
+	     double c, int n)
+{
+  __m512d k = _mm512_set1_pd (c);
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    {
+      __m512d t = _mm512_add_pd (_mm512_loadu_pd (a + j),
+				 _mm512_loadu_pd (b + j));
+
+      _mm512_storeu_pd (d + j, _mm512_add_pd (_mm512_loadu_pd (s + j),
+					      _mm512_mul_pd (k, t)));
+    }
+
+  step_avx (d + j, s + j, a + j, b + j, c, n - j);
+}
+
+TARGET ("avx512f")
+static void
+fstep_avx512 (float *d, const float *s, const float *a, const float *b,
+	     float c, int n)
+{
+  __m512 k = _mm512_set1_ps (c);
+  int j;
+
+  for (j = 0; j + 16 <= n; j += 16)
+    {
+      __m512 t = _mm512_add_ps (_mm512_loadu_ps (a + j),
+				_mm512_loadu_ps (b + j));
+
+      _mm512_storeu_ps (d + j, _mm512_add_ps (_mm512_loadu_ps (s + j),
+					      _mm512_mul_ps (k, t)));
+    }
+
+  fstep_c (d + j, s + j, a + j, b + j, c, n - j);
+}
+
+TARGET ("avx512f")
+static void
+fscale_avx512 (float *d, float c, int n)
+{
+  __m512 k = _mm512_set1_ps (c);
+  int j;
+
+  for (j = 0; j + 16 <= n; j += 16)
+    _mm512_storeu_ps (d + j, _mm512_mul_ps (_mm512_loadu_ps (d + j), k));
+
+  fscale_c (d + j, c, n - j);
+}
+
+TARGET ("avx512f")
+static void
+istep_avx512 (int *d, const int *s, const int *a, const int *b, int add,
+	      int shift, int sign, int n)
+{
+  __m512i k = _mm512_set1_epi32 (add);
+  __m128i c = _mm_cvtsi32_si128 (shift);
+  int j;
+
+  for (j = 0; j + 16 <= n; j += 16)
+    {
+      __m512i t = _mm512_add_epi32 (_mm512_loadu_si512 (a + j),
+				    _mm512_loadu_si512 (b + j));
+      __m512i x = _mm512_loadu_si512 (s + j);
+
+      t = _mm512_sra_epi32 (_mm512_add_epi32 (t, k), c);
+      x = (sign > 0) ? _mm512_add_epi32 (x, t) : _mm512_sub_epi32 (x, t);
+      _mm512_storeu_si512 (d + j, x);
+    }
+
+  istep_sse2 (d + j, s + j, a + j, b + j, add, shift, sign, n - j);
+}
+
+TARGET ("avx512f")
+static void
+scale_avx512 (double *d, double c, int n)
+{
+  __m512d k = _mm512_set1_pd (c);
+  int j;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    _mm512_storeu_pd (d + j, _mm512_mul_pd (_mm512_loadu_pd (d + j), k));
+
+  scale_avx (d + j, c, n - j);
+}
+
+TARGET ("avx512f")
+static void
+split_avx512 (double *even, double *odd, const double *x, int n)
+{
+  __m512i ie = _mm512_set_epi64 (14, 12, 10, 8, 6, 4, 2, 0);
+  __m512i io = _mm512_set_epi64 (15, 13, 11, 9, 7, 5, 3, 1);
+  int j;
+
+  for (j = 0; j + 16 <= n; j += 16)
+    {
+      __m512d x0 = _mm512_loadu_pd (x + j);
+      __m512d x1 = _mm512_loadu_pd (x + j + 8);
+
+      _mm512_storeu_pd (even + (j >> 1), _mm512_permutex2var_pd (x0, ie, x1));
+      _mm512_storeu_pd (odd + (j >> 1), _mm512_permutex2var_pd (x0, io, x1));
+    }
+
+  split_avx (even + (j >> 1), odd + (j >> 1), x + j, n - j);
+}
+
+TARGET ("avx512f")
+static void
+merge_avx512 (double *x, const double *even, const double *odd, int n)
+{
+  __m512i ilo = _mm512_set_epi64 (11, 3, 10, 2, 9, 1, 8, 0);
+  __m512i ihi = _mm512_set_epi64 (15, 7, 14, 6, 13, 5, 12, 4);
+  int j;
+
+  for (j = 0; j + 16 <= n; j += 16)
+    {
+      __m512d e = _mm512_loadu_pd (even + (j >> 1));
+      __m512d o = _mm512_loadu_pd (odd + (j >> 1));
+
+      _mm512_storeu_pd (x + j, _mm512_permutex2var_pd (e, ilo, o));
+      _mm512_storeu_pd (x + j + 8, _mm512_permutex2var_pd (e, ihi, o));
+    }
+
+  merge_avx (x + j, even + (j >> 1), odd + (j >> 1), n - j);
+}
+
+#endif /* LIFTING_X86 */
+
+
+/*****************************************
+ *  Dispatch                             *
+ *****************************************/
+
+static const lifting_kernels_t lifting_kernels[] = {
+  {step_c, scale_c, split_c, merge_c, istep_c,
+   fstep_c, fscale_c},
+#ifdef LIFTING_X86
+  {step_sse2, scale_sse2, split_sse2, merge_sse2, istep_sse2,
+   fstep_sse2, fscale_sse2},
+  {step_avx, scale_avx, split_avx, merge_avx, istep_avx2,
+   fstep_avx, fscale_avx},
+  {step_avx512, scale_avx512, split_avx512, merge_avx512, istep_avx512,
+   fstep_avx512, fscale_avx512},
+#endif
+};
+
+#ifdef LIFTING_X86
+/* the integer kernels of the AVX level need AVX2 */
+static const lifting_kernels_t lifting_avx_sse2 =
+  {step_avx, scale_avx, split_avx, merge_avx, istep_sse2,
+   fstep_avx, fscale_avx};
+#endif
+
+/* selected kernels; the selection on first use may be made by several
+   threads at once, which all store the same value                     */
+static const lifting_kernels_t *lifting = NULL;
+static int lifting_selected = LIFTING_C;
+
+static int
+lifting_supported (int isa)
+{
+#ifdef LIFTING_X86
+  __builtin_cpu_init ();
+
+  switch (isa)
+    {
+    case LIFTING_SSE2:
+      return (__builtin_cpu_supports ("sse2"));
+    case LIFTING_AVX:
+      return (__builtin_cpu_supports ("avx"));
+    case LIFTING_AVX512:
+      return (__builtin_cpu_supports ("avx512f"));
+    }
+#endif
+
+  return (isa == LIFTING_C);
+}
+
+int
+lifting_set_isa (int isa)
+{
+  if (isa > LIFTING_AVX512)
+    isa = LIFTING_AVX512;
+
+  while (isa > LIFTING_C && !lifting_supported (isa))
+    isa--;
+
+  lifting_selected = isa;
+  lifting = &lifting_kernels[isa];
+#ifdef LIFTING_X86
+  if (isa == LIFTING_AVX && !__builtin_cpu_supports ("avx2"))
+    lifting = &lifting_avx_sse2;
+#endif
+
+  return (isa);
+}
+
+int
+lifting_isa (void)
+{
+  if (lifting == NULL)
+    lifting_set_isa (LIFTING_AVX512);
+
+  return (lifting_selected);
+}
+
+static const lifting_kernels_t *
+kernels (void)
+{
+  if (lifting == NULL)
+    lifting_set_isa (LIFTING_AVX512);
+
+  return (lifting);
+}
+
+void
+lifting_step (double *d, const double *s, const double *a, const double *b,
+	      double c, int n)
+{
+  kernels ()->step (d, s, a, b, c, n);
+}
+
+void
+lifting_scale (double *d, double c, int n)
+{
+  kernels ()->scale (d, c, n);
+}
+
+void
+lifting_split (double *even, double *odd, const double *x, int n)
+{
+  kernels ()->split (even, odd, x, n);
+}
+
+void
+lifting_merge (double *x, const double *even, const double *odd, int n)
+{
+  kernels ()->merge (x, even, odd, n);
+}
+
+void
+lifting_fstep (float *d, const float *s, const float *a, const float *b,
+	       float c, int n)
+{
+  kernels ()->fstep (d, s, a, b, c, n);
+}
+
+void
+lifting_fscale (float *d, float c, int n)
+{
+  kernels ()->fscale (d, c, n);
+}
+
+void
+lifting_fsplit (float *even, float *odd, const float *x, int n)
+{
+  int j;
+
+  for (j = 0; j + 1 < n; j += 2)
+    {
+      even[j >> 1] = x[j];
+      odd[j >> 1] = x[j + 1];
+    }
+  if (j < n)
+    even[j >> 1] = x[j];
+}
+
+void
+lifting_fmerge (float *x, const float *even, const float *odd, int n)
+{
+  int j;
+
+  for (j = 0; j + 1 < n; j += 2)
+    {
+      x[j] = even[j >> 1];
+      x[j + 1] = odd[j >> 1];
+    }
+  if (j < n)
+    x[j] = even[j >> 1];
+}
+
+void
+lifting_istep (int *d, const int *s, const int *a, const int *b, int add,
+	       int shift, int sign, int n)
+{
+  kernels ()->istep (d, s, a, b, add, shift, sign, n);
+}
+
+void
+lifting_isplit (int *even, int *odd, const int *x, int n)
+{
+  int j;
+
+  for (j = 0; j + 1 < n; j += 2)
+    {
+      even[j >> 1] = x[j];
+      odd[j >> 1] = x[j + 1];
+    }
+  if (j < n)
+    even[j >> 1] = x[j];
+}
+
+void
+lifting_imerge (int *x, const int *even, const int *odd, int n)
+{
+  int j;
+
+  for (j = 0; j + 1 < n; j += 2)
+    {
+      x[j] = even[j >> 1];
+      x[j + 1] = odd[j >> 1];
+    }
+  if (j < n)
+    x[j] = even[j >> 1];
+}
@@ -27,6 +27,7 @@
 #include "../include/io.h"
 #include "../include/random.h"
 #include "../include/cplx.h"
+#include "../include/arena.h"
 
 #include <math.h>
 /*----------------------------------------------------------------------------*/
@@ -35,49 +36,87 @@
 
 
 void mat_copy( mat dest, mat orig ) {
-  idx_t i, j;
+  idx_t i;
   assert( dest );
   assert( orig );
   assert( mat_width_max( dest ) >= mat_width( orig ) );
   assert( mat_height_max( dest ) >= mat_height( orig ) );
   for( i = 0 ; i < mat_height( orig ) ; i++ )
-    for( j = 0 ; j < mat_width( orig ) ; j++ )
-      dest[ i ][ j ] = orig[ i ][ j ];
+    memcpy( dest[ i ], orig[ i ], mat_width( orig ) * sizeof( double ) );
 }
 
 
 void imat_copy( imat dest, imat orig ) {
-  idx_t i, j;
+  idx_t i;
   assert( dest );
   assert( orig );
   assert( imat_width_max( dest ) >= imat_width( orig ) );
   assert( imat_height_max( dest ) >= imat_height( orig ) );
   for( i = 0 ; i < imat_height( orig ) ; i++ )
-    for( j = 0 ; j < imat_width( orig ) ; j++ )
-      dest[ i ][ j ] = orig[ i ][ j ];
+    memcpy( dest[ i ], orig[ i ], imat_width( orig ) * sizeof( int ) );
 }
 
 
 void bmat_copy( bmat dest, bmat orig ) {
-  idx_t i, j;
+  idx_t i;
   assert( dest );
   assert( orig );
   assert( bmat_width_max( dest ) >= bmat_width( orig ) );
   assert( bmat_height_max( dest ) >= bmat_height( orig ) );
   for( i = 0 ; i < bmat_height( orig ) ; i++ )
-    for( j = 0 ; j < bmat_width( orig ) ; j++ )
-      dest[ i ][ j ] = orig[ i ][ j ];
+    memcpy( dest[ i ], orig[ i ], bmat_width( orig ) * sizeof( byte ) );
 }
 
 void cmat_copy( cmat dest, cmat orig ) {
-  idx_t i, j;
+  idx_t i;
   assert( dest );
   assert( orig );
   assert( cmat_width_max( dest ) >= cmat_width( orig ) );
   assert( cmat_height_max( dest ) >= cmat_height( orig ) );
   for( i = 0 ; i < cmat_height( orig ) ; i++ )
-    for( j = 0 ; j < cmat_width( orig ) ; j++ )
-      dest[ i ][ j ] = orig[ i ][ j ];
+    memcpy( dest[ i ], orig[ i ], cmat_width( orig ) * sizeof( cplx ) );
+}
+
+/*------------------------------------------------------------------*/
+#define __align_up( p, a ) ((char *) (((size_t) (p) + (a) - 1) & ~((size_t) (a) - 1)))
+
+Mat __Mat_new_slab( size_t elem_size, idx_t h, idx_t w )
+{
+  size_t stride = Mat_slab_stride( elem_size, w );
+  Vec_header_t *hdr;
+  char *ptr, *owner, *rows;
+  size_t size;
+  Mat m;
+  idx_t i;
+
+  size = sizeof(Vec_header_t) + IT_ALLOC_ALIGN + h * sizeof(Vec)
+       + sizeof(Vec_header_t) + IT_MAT_ALIGN + h * stride;
+  owner = NULL;
+  if( !(ptr = (char *) it_arena_alloc( size )) )
+    ptr = owner = (char *) malloc( size );
+  it_assert( ptr != NULL, "No enough memory to allocate the matrix" );
+  Vec_alloc_account( h * sizeof(Vec) + h * w * elem_size );
+
+  /* the vector of the rows, which owns the block (unless in an arena) */
+  m = (Mat) __align_up( ptr + sizeof(Vec_header_t), IT_ALLOC_ALIGN );
+  hdr = (Vec_header_t *) m - 1;
+  hdr->length = h;
+  hdr->length_max = h;
+  hdr->ptr = owner;
+  hdr->element_size = sizeof(Vec);
+
+  /* the rows, each one after its header */
+  rows = __align_up( (char *) (m + h) + sizeof(Vec_header_t), IT_MAT_ALIGN );
+  for( i = 0 ; i < h ; i++ ) {
+    m[i] = rows + i * stride;
+    hdr = (Vec_header_t *) m[i] - 1;
+    hdr->length = w;
+    hdr->length_max = w;
+    hdr->ptr = NULL;
+    hdr->element_size = elem_size;
+  }
+
+  return(m);
 }
 
 /*------------------------------------------------------------------*/
@@ -631,6 +670,28 @@ void mat_sub( mat m1, mat m2 )
 }
 
 
+void mat_axpy( mat m1, double a, mat m2 )
+{
+  idx_t i;
+  assert( m1 );
+  assert( m2 );
+  assert( mat_height( m1 ) == mat_height( m2 ) );
+  for( i = 0 ; i < mat_height( m1 ) ; i++ )
+    vec_axpy( m1[ i ], a, m2[ i ] );
+}
+
+
+void mat_axpby( mat m1, double a, mat m2, double b )
+{
+  idx_t i;
+  assert( m1 );
+  assert( m2 );
+  assert( mat_height( m1 ) == mat_height( m2 ) );
+  for( i = 0 ; i < mat_height( m1 ) ; i++ )
+    vec_axpby( m1[ i ], a, m2[ i ], b );
+}
+
+
 void imat_add( imat m1, imat m2 )
 {
   imat_elem_add( m1, m2 );
@@ -1623,6 +1684,99 @@ bmat bmat_set_submatrix( bmat m, bmat s, idx_t r, idx_t c )
 }
 
 
+/*----------------------------------------------------------------------------*/
+/* Views                                                                      */
+mat_view mat_get_submatrix_view( mat m, idx_t r1, idx_t c1, idx_t r2, idx_t c2 )
+{
+  mat_view s;
+  idx_t r;
+
+  MAT_END_ROW_PARAM( m, r1 );
+  MAT_END_ROW_PARAM( m, r2 );
+  MAT_END_COL_PARAM( m, c1 );
+  MAT_END_COL_PARAM( m, c2 );
+
+  it_assert( r1 >= 0 && c1 >= 0 && r1 <= r2 && c1 <= c2
+	     && r2 < mat_height( m ) && c2 < mat_width( m ),
+	     "Invalid col or row number" );
+
+  s.stride = ( mat_height( m ) > 1 ) ? m[ 1 ] - m[ 0 ] : mat_width( m );
+  for( r = 1 ; r < mat_height( m ) ; r++ )
+    it_assert( m[ r ] == m[ 0 ] + r * s.stride,
+	       "The rows of the matrix are not in a single block" );
+
+  s.data = m[ r1 ] + c1;
+  s.height = r2 - r1 + 1;
+  s.width = c2 - c1 + 1;
+  return s;
+}
+
+
+mat_view mat_view_get_submatrix( mat_view s, idx_t r1, idx_t c1, idx_t r2, idx_t c2 )
+{
+  mat_view t;
+
+  it_assert( r1 >= 0 && c1 >= 0 && r1 <= r2 && c1 <= c2
+	     && r2 < s.height && c2 < s.width,
+	     "Invalid col or row number" );
+
+  t.data = s.data + r1 * s.stride + c1;
+  t.height = r2 - r1 + 1;
+  t.width = c2 - c1 + 1;
+  t.stride = s.stride;
+  return t;
+}
+
+
+idx_t mat_view_to_vec( mat_view s, vec v, idx_t idx )
+{
+  idx_t r;
+
+  for( r = 0 ; r < s.height ; r++ )
+    idx = vec_view_to_vec( mat_view_row( s, r ), v, idx );
+  return idx;
+}
+
+
+idx_t vec_to_mat_view( vec v, idx_t idx, mat_view s )
+{
+  idx_t r;
+
+  for( r = 0 ; r < s.height ; r++ )
+    idx = vec_to_vec_view( v, idx, mat_view_row( s, r ) );
+  return idx;
+}
+
+
+void mat_view_copy( mat_view dst, mat_view src )
+{
+  idx_t r;
+
+  assert( dst.height == src.height );
+  for( r = 0 ; r < src.height ; r++ )
+    vec_view_copy( mat_view_row( dst, r ), mat_view_row( src, r ) );
+}
+
+
+void mat_view_mul_by( mat_view s, double a )
+{
+  idx_t r;
+
+  for( r = 0 ; r < s.height ; r++ )
+    vec_view_mul_by( mat_view_row( s, r ), a );
+}
+
+
+void mat_view_axpy( mat_view y, double a, mat_view x )
+{
+  idx_t r;
+
+  assert( y.height == x.height );
+  for( r = 0 ; r < y.height ; r++ )
+    vec_view_axpy( mat_view_row( y, r ), a, mat_view_row( x, r ) );
+}
+
+
 /*----------------------------------------------------------------------------*/
 vec mat_copy_col( vec v, mat m, idx_t c)
 {
@@ -40,6 +40,7 @@ parser_t * _parser_add_string( parser_t * p, char * s )
   } else {
     /* initialize the parser by creating a new parser multiline */
     Vec_push(p, (char *) malloc(sizeof(char)));
+    Vec_alloc_account(sizeof(char));
     line = Vec_head(p);
     line[0] = 0;
   }
@@ -76,6 +77,7 @@ parser_t * _parser_add_string( parser_t * p, char * s )
     if(strchr( s, '=') && strchr( s, '=') < next_endl) {
       /* create a new multiline */
       Vec_push(p, (char *) malloc((line_len + 2) * sizeof(char)));
+      Vec_alloc_account((line_len + 2) * sizeof(char));
       line = Vec_head(p);
       strncpy( line, s, line_len );
       line[line_len + 1] = 0;
@@ -85,6 +87,7 @@ parser_t * _parser_add_string( parser_t * p, char * s )
       line = Vec_head(p);
       line = (char *) realloc(line,
 			      (strlen(line) + line_len + 2) * sizeof(char));
+      Vec_alloc_account((strlen(line) + line_len + 2) * sizeof(char));
       strncat( line, s, line_len );
       line[strlen(line) + 1] = 0;
       line[strlen(line)] = '\n';
@@ -106,6 +109,7 @@ parser_t * _parser_add_params( parser_t * p, int argc, char ** argv )
   char * line;
   for( i = 1 ; i < argc ; i++ ) {
     line = (char *) malloc( strlen( argv[ i ] ) + 1 );
+    Vec_alloc_account( strlen( argv[ i ] ) + 1 );
     strcpy( line, argv[ i ] );
     Vec_push( p, line );
   }
@@ -129,6 +133,7 @@ parser_t * _parser_add_file( parser_t * p, const char * filename )
   fseek( F, 0, SEEK_SET );
 
   Fstring = (char *) malloc( Fsize + 1 );
+  Vec_alloc_account( Fsize + 1 );
   fread( Fstring, Fsize, 1, F );
 
   /* replace ; with \n to handle multiple variables per line */
@@ -346,6 +351,7 @@ char * parser_get_string( const parser_t * p, const char * varname )
 
     /* Violent malloc */
     rs = (char *) malloc( rs_len + 1 );
+    Vec_alloc_account( rs_len + 1 );
     strncpy( rs, s, rs_len );
     rs[ rs_len ] = '\0';
 
@@ -0,0 +1,224 @@
+/*
+  Pool of worker threads.
+*/
+
+#include <stdlib.h>
+#include <pthread.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "../include/io.h"
+#include "../include/pool.h"
+
+#define POOL_MAX_THREADS 256
+
+/* tasks [lo, hi) of one thread that are not started yet */
+typedef struct _pool_queue_
+{
+  pthread_mutex_t lock;
+  int lo;
+  int hi;
+} pool_queue_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+
+static pool_queue_t pool_queues[POOL_MAX_THREADS];
+static int pool_seen[POOL_MAX_THREADS];	/* last job seen by each worker   */
+
+static int pool_nthreads = 1;	/* threads used by pool_run          */
+static int pool_nworkers = 0;	/* worker threads created so far     */
+static int pool_job = 0;	/* number of the current job         */
+static int pool_active = 0;	/* threads taking part in the job    */
+static int pool_running = 0;	/* workers still busy with the job   */
+static int pool_busy = 0;	/* a job is in progress              */
+static void (*pool_fn) (void *arg, int task);
+static void *pool_arg;
+
+
+/*****************************************
+ *  Scheduling                           *
+ *****************************************/
+
+/* next task of the own range of thread me, -1 if none */
+static int
+pool_pop (int me)
+{
+  pool_queue_t *q = &pool_queues[me];
+  int t = -1;
+
+  pthread_mutex_lock (&q->lock);
+  if (q->lo < q->hi)
+    t = q->lo++;
+  pthread_mutex_unlock (&q->lock);
+
+  return (t);
+}
+
+/* last task of the range of another thread, -1 if all are exhausted */
+static int
+pool_steal (int me)
+{
+  pool_queue_t *q;
+  int v, t = -1;
+
+  for (v = 1; v < pool_active && t < 0; v++)
+    {
+      q = &pool_queues[(me + v) % pool_active];
+
+      pthread_mutex_lock (&q->lock);
+      if (q->lo < q->hi)
+	t = --q->hi;
+      pthread_mutex_unlock (&q->lock);
+    }
+
+  return (t);
+}
+
+static void
+pool_work (int me)
+{
+  int t;
+
+  for (;;)
+    {
+      t = pool_pop (me);
+      if (t < 0)
+	t = pool_steal (me);
+      if (t < 0)
+	return;
+
+      pool_fn (pool_arg, t);
+    }
+}
+
+static void *
+pool_worker (void *p)
+{
+  int me = (int) (size_t) p;
+  int job;
+
+  pthread_mutex_lock (&pool_lock);
+  job = pool_seen[me];
+
+  for (;;)
+    {
+      while (pool_job == job)
+	pthread_cond_wait (&pool_start, &pool_lock);
+      job = pool_job;
+
+      if (me >= pool_active)
+	continue;
+
+      pthread_mutex_unlock (&pool_lock);
+      pool_work (me);
+      pthread_mutex_lock (&pool_lock);
+
+      if (--pool_running == 0)
+	pthread_cond_signal (&pool_done);
+    }
+
+  return (NULL);
+}
+
+
+/*****************************************
+ *  Interface                            *
+ *****************************************/
+
+void
+pool_set_threads (int nthreads)
+{
+  if (nthreads <= 0)
+    {
+#ifdef WIN32
+      SYSTEM_INFO info;
+      GetSystemInfo (&info);
+      nthreads = info.dwNumberOfProcessors;
+#else
+      nthreads = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+    }
+
+  if (nthreads < 1)
+    nthreads = 1;
+  if (nthreads > POOL_MAX_THREADS)
+    nthreads = POOL_MAX_THREADS;
+
+  pthread_mutex_lock (&pool_lock);
+  pool_nthreads = nthreads;
+  pthread_mutex_unlock (&pool_lock);
+}
+
+int
+pool_threads (void)
+{
+  return (pool_nthreads);
+}
+
+void
+pool_run (int n_tasks, void (*fn) (void *arg, int task), void *arg)
+{
+  pthread_t thread;
+  int nthreads, i, t;
+
+  pthread_mutex_lock (&pool_lock);
+
+  nthreads = (pool_nthreads < n_tasks) ? pool_nthreads : n_tasks;
+  if (pool_busy || nthreads <= 1)
+    {
+      pthread_mutex_unlock (&pool_lock);
+      for (t = 0; t < n_tasks; t++)
+	fn (arg, t);
+      return;
+    }
+  pool_busy = 1;
+
+  if (pool_nworkers == 0)
+    pthread_mutex_init (&pool_queues[0].lock, NULL);
+
+  /* the workers are created on demand and kept for the next loops */
+  while (pool_nworkers < nthreads - 1)
+    {
+      i = pool_nworkers + 1;
+      pthread_mutex_init (&pool_queues[i].lock, NULL);
+      pool_seen[i] = pool_job;
+
+      if (pthread_create (&thread, NULL, pool_worker, (void *) (size_t) i))
+	{
+	  it_warning ("pool: unable to create more than %d threads\n", i);
+	  nthreads = i;
+	  break;
+	}
+      pthread_detach (thread);
+      pool_nworkers = i;
+    }
+
+  for (i = 0; i < nthreads; i++)
+    {
+      pool_queues[i].lo = (int) ((long long) n_tasks * i / nthreads);
+      pool_queues[i].hi = (int) ((long long) n_tasks * (i + 1) / nthreads);
+    }
+
+  pool_fn = fn;
+  pool_arg = arg;
+  pool_active = nthreads;
+  pool_running = nthreads - 1;
+  pool_job++;
+
+  pthread_cond_broadcast (&pool_start);
+  pthread_mutex_unlock (&pool_lock);
+
+  /* the calling thread takes its share */
+  pool_work (0);
+
+  pthread_mutex_lock (&pool_lock);
+  while (pool_running > 0)
+    pthread_cond_wait (&pool_done, &pool_lock);
+  pool_busy = 0;
+  pthread_mutex_unlock (&pool_lock);
+}
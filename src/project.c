@@ -44,6 +44,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "../include/random.h"
 
 #include "../include/constants.h"
+#include "../include/antipodal.h"
 #include "../include/project.h"
 
 
@@ -56,27 +57,14 @@ projectSubspace (vec s_X, unsigned int *alea, vec v_X)
 {
   int N_s = vec_length (s_X);	/* Dimension of the Wavelet space       */
   int N_v = vec_length (v_X);	/* Dimension of the secret subspace     */
-  int i, j;
-  long k = 0;
+  int i;
   double pos = 1 / sqrt (N_s);
 
+  /* one alea number is used 32 times, generating 32 carriers binary samples */
+  antipodal_project (s_X, N_s, alea, v_X, N_v);
+
   for (i = 0; i < N_v; i++)
-    {
-      for (j = 0; j < N_s; j++)
-	{
-	  /* one alea number is used 32 times, generating 32 carriers binary samples */
-	  if ((alea[k / 32] & (1 << (k % 32))) != 0)
-	    {
-	      v_X[i] += s_X[j];
-	    }
-	  else
-	    {
-	      v_X[i] -= s_X[j];
-	    }
-	  k++;
-	}
-      v_X[i] *= pos;
-    }
+    v_X[i] *= pos;
 
   return (1);
 }
@@ -101,13 +89,9 @@ projectMCB (vec v_X, vec v_C, vec v_e1, vec v_e2, double *c_X_1, double *c_X_2)
   /* Graham-Schmidt orthonomalization */
   /* Eq (3) of the paper */
 
-  /* v_e2 = v_X - c_X_1 * v_e1*/
-  vec_copy (v_e2, v_e1);
-  vec_mul_by (v_e2, *c_X_1);
-  vec_sub (v_e2, v_X);
-  vec_neg (v_e2);
-
-  normE2 = vec_norm (v_e2, 2);
+  /* v_e2 = v_X - c_X_1 * v_e1, its norm taken in the same pass */
+  vec_copy (v_e2, v_X);
+  normE2 = vec_axpy_norm (v_e2, -*c_X_1, v_e1);
   vec_div_by (v_e2, normE2);	/* normalized it */
 
   *c_X_2 = vec_inner_product (v_X, v_e2);	/* projection of v_X on v_e2 */
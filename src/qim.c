@@ -0,0 +1,1323 @@
+/*
+  Scalar QIM on secret Gaussian carriers.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "../include/vec.h"
+#include "../include/mat.h"
+#include "../include/random.h"
+#include "../include/io.h"
+#include "../include/pool.h"
+
+#include "../include/qim.h"
+
+
+/*****************************************
+ *  Decision rule                        *
+ *****************************************/
+
+int
+qim_bit (double produit, double pas)
+{
+  /* Cell in which the projection falls, its parity is the bit */
+  int cellule = (int) floor (produit / pas);
+
+  return (((int) fabs (cellule)) % 2);
+}
+
+double
+qim_displacement (double produit, double pas, int bit)
+{
+  int cellule = (int) floor (produit / pas);
+  double d, d1, d2;
+
+  if (bit == qim_bit (produit, pas))
+    {
+      /* Center of this cell */
+      d = (cellule + 0.5) * pas - produit;
+    }
+  else
+    {
+      /* Center of the nearest neighbour cell */
+      d1 = fabs ((cellule - 0.5) * pas - produit);
+      d2 = fabs ((cellule + 1.5) * pas - produit);
+
+      d = (cellule - 0.5) * pas - produit;
+      if (d2 < d1)
+	d = (cellule + 1.5) * pas - produit;
+    }
+
+  return (d);
+}
+
+
+/*****************************************
+ *  Parallel loops                       *
+ *  The tasks are groups of QIM_GROUP    *
+ *  carriers or chunks of QIM_CHUNK      *
+ *  samples. The partitions do not       *
+ *  depend on the number of threads and  *
+ *  each task writes its own outputs,    *
+ *  hence the results do not either.     *
+ *****************************************/
+
+/* number of carriers per task */
+#define QIM_GROUP 8
+
+/* number of samples per task */
+#define QIM_CHUNK (16 * QIM_TILE)
+
+#define NB_GROUPS(k) (((k) + QIM_GROUP - 1) / QIM_GROUP)
+#define NB_CHUNKS(N) (((N) + QIM_CHUNK - 1) / QIM_CHUNK)
+
+typedef struct _qim_loop_
+{
+  vec s_X;			/* host vector                     */
+  vec *carriers;		/* stored carriers                 */
+  int nb_bits;
+  double *a;			/* produits, or update coefficients */
+  mat G;			/* Gram matrix                     */
+  int diag;			/* with its diagonal               */
+} qim_loop_t;
+
+/* a[i] = <s_X, c_i> for the carriers of group g */
+static void
+project_task (void *arg, int g)
+{
+  qim_loop_t *t = (qim_loop_t *) arg;
+  int i0 = g * QIM_GROUP;
+  int k = (t->nb_bits - i0 < QIM_GROUP) ? t->nb_bits - i0 : QIM_GROUP;
+
+  vec_inner_product_many (t->s_X, t->carriers + i0, k, t->a + i0);
+}
+
+/* G[i][l] = <c_i, c_l> for l < i, or l <= i */
+static void
+gram_task (void *arg, int i)
+{
+  qim_loop_t *t = (qim_loop_t *) arg;
+
+  vec_inner_product_many (t->carriers[i], t->carriers, i + t->diag,
+			  t->G[i]);
+}
+
+/* s_X += sum_i a[i] c_i on the samples of chunk c */
+static void
+add_task (void *arg, int c)
+{
+  qim_loop_t *t = (qim_loop_t *) arg;
+  int N_s = vec_length (t->s_X);
+  int j0 = c * QIM_CHUNK;
+  int n = (N_s - j0 < QIM_CHUNK) ? N_s - j0 : QIM_CHUNK;
+  double **w = (double **) malloc (sizeof (double *) * (t->nb_bits + 1));
+  int i;
+
+  for (i = 0; i < t->nb_bits; i++)
+    w[i] = t->carriers[i] + j0;
+  __vec_add_many (t->s_X + j0, w, t->a, t->nb_bits, n);
+
+  free (w);
+}
+
+static void
+qim_project_all (vec s_X, vec * carriers, int nb_bits, vec produits)
+{
+  qim_loop_t t = { s_X, carriers, nb_bits, produits, NULL, 0 };
+
+  pool_run (NB_GROUPS (nb_bits), project_task, &t);
+}
+
+static void
+qim_gram (vec * carriers, int nb_bits, mat G, int diag)
+{
+  qim_loop_t t = { NULL, carriers, nb_bits, NULL, G, diag };
+
+  pool_run (nb_bits, gram_task, &t);
+}
+
+static void
+qim_add_all (vec s_X, vec * carriers, int nb_bits, vec a)
+{
+  qim_loop_t t = { s_X, carriers, nb_bits, a, NULL, 0 };
+
+  pool_run (NB_CHUNKS (vec_length (s_X)), add_task, &t);
+}
+
+
+/*****************************************
+ *  Sequential embedding                 *
+ *  The bits are embedded one after the  *
+ *  other, the carriers being taken by   *
+ *  blocks of QIM_SEQ_BLOCK. A single    *
+ *  pass over the host adds the carriers *
+ *  of the previous block and correlates *
+ *  those of the block with the host and *
+ *  with each other, tile by tile: the   *
+ *  displacements of the block follow    *
+ *  from these. The cost is O(k dim),    *
+ *  with k / QIM_SEQ_BLOCK passes over   *
+ *  the host and two over the carriers.  *
+ *****************************************/
+
+/* d[i] is the displacement of carrier i once carriers 0..i-1 have been
+   moved by d[0..i-1]. G holds <c_i, c_l> for l < i in G[i][l].         */
+static void
+qim_displacements (vec produits, mat G, int *mot, int nb_bits, double pas,
+		   vec d)
+{
+  double produit;
+  int i, l;
+
+  for (i = 0; i < nb_bits; i++)
+    {
+      produit = produits[i];
+      for (l = 0; l < i; l++)
+	produit += d[l] * G[i][l];
+
+      d[i] = qim_displacement (produit, pas, mot[i]);
+    }
+}
+
+
+/* number of carriers per block */
+#define QIM_SEQ_BLOCK 4
+
+/* sums of a block for one chunk: products, then Gram matrix */
+#define QIM_SEQ_SUMS (QIM_SEQ_BLOCK + QIM_SEQ_BLOCK * QIM_SEQ_BLOCK)
+
+/* The engines read the carriers tile by tile: in place when they are
+   stored in double, converted from their compact type or drawn from
+   the keyed generator otherwise.                                      */
+typedef struct _qim_source_
+{
+  vec *carriers;		/* stored in double, or NULL         */
+  qim_packed_t *packed;		/* stored in a compact type, or NULL */
+  unsigned int const *key;	/* drawn from the keyed generator    */
+} qim_source_t;
+
+/* buffer for the tiles of k carriers, if they are not stored in double */
+static double *
+source_buffer (qim_source_t const *src, int k)
+{
+  if (src->carriers)
+    return (NULL);
+  return ((double *) malloc (sizeof (double) * k * QIM_TILE));
+}
+
+/* samples j0..j0+n-1 of the carriers i0..i0+k-1, in the rows of buf
+   from row r if they are not stored in double                       */
+static void
+source_tile (qim_source_t const *src, double **rows, double *buf, int r,
+	     int i0, int k, int j0, int n)
+{
+  qim_packed_t *p = src->packed;
+  int i, j;
+
+  for (i = 0; i < k; i++)
+    {
+      if (src->carriers)
+	{
+	  rows[i] = src->carriers[i0 + i] + j0;
+	  continue;
+	}
+
+      rows[i] = buf + (r + i) * QIM_TILE;
+      if (p && p->type == QIM_F32)
+	{
+	  float const *f = (float const *) p->data[i0 + i] + j0;
+
+	  for (j = 0; j < n; j++)
+	    rows[i][j] = f[j];
+	}
+      else if (p)
+	{
+	  signed char const *q = (signed char const *) p->data[i0 + i] + j0;
+	  double scale = p->scale[i0 + i];
+
+	  for (j = 0; j < n; j++)
+	    rows[i][j] = q[j] * scale;
+	}
+      else
+	it_keyed_randn_fill (src->key, i0 + i, j0, rows[i], n);
+    }
+}
+
+typedef struct _qim_seq_
+{
+  vec s_X;			/* host vector                      */
+  qim_source_t src;		/* carriers                         */
+  int i0, k;			/* carriers of the block            */
+  int l0, m;			/* carriers of the previous block   */
+  double *a;			/* and their update coefficients    */
+  double *sums;			/* QIM_SEQ_SUMS per chunk           */
+} qim_seq_t;
+
+/* s_X += sum_l a[l] c_l for the previous block, then the products and
+   the Gram matrix of the block, on the samples of chunk c              */
+static void
+seq_task (void *arg, int c)
+{
+  qim_seq_t *t = (qim_seq_t *) arg;
+  int N_s = vec_length (t->s_X);
+  int j0 = c * QIM_CHUNK;
+  int j1 = (N_s - j0 < QIM_CHUNK) ? N_s : j0 + QIM_CHUNK;
+  double *p = t->sums + c * QIM_SEQ_SUMS;
+  double *G = p + QIM_SEQ_BLOCK;
+  double *prev[QIM_SEQ_BLOCK], *rows[QIM_SEQ_BLOCK];
+  double *buf = source_buffer (&t->src, 2 * QIM_SEQ_BLOCK);
+  int i, n;
+
+  for (; j0 < j1; j0 += n)
+    {
+      n = (j1 - j0 < QIM_TILE) ? j1 - j0 : QIM_TILE;
+      source_tile (&t->src, prev, buf, 0, t->l0, t->m, j0, n);
+      source_tile (&t->src, rows, buf, QIM_SEQ_BLOCK, t->i0, t->k, j0, n);
+
+      __vec_add_many (t->s_X + j0, prev, t->a, t->m, n);
+      __vec_inner_product_many (t->s_X + j0, rows, t->k, n, p);
+      for (i = 0; i < t->k; i++)
+	__vec_inner_product_many (rows[i], rows, i + 1, n,
+				  G + i * QIM_SEQ_BLOCK);
+    }
+
+  free (buf);
+}
+
+/* Embeds the bits one after the other. The keyed carriers are
+   normalized on the fly, their norms being those of the diagonal of
+   the Gram matrix of their block.                                    */
+static void
+qim_embed_seq (qim_seq_t * t, int *mot, int nb_bits, double pas,
+	       int normalize)
+{
+  int nb_chunks = NB_CHUNKS (vec_length (t->s_X));
+  double a[QIM_SEQ_BLOCK], p[QIM_SEQ_BLOCK], norm[QIM_SEQ_BLOCK];
+  double G[QIM_SEQ_BLOCK][QIM_SEQ_BLOCK];
+  double produit;
+  int c, i, l, i0, k;
+
+  t->sums = (double *) malloc (sizeof (double) * QIM_SEQ_SUMS * nb_chunks);
+  t->a = a;
+  t->m = 0;
+
+  for (i0 = 0; i0 <= nb_bits; i0 += k)
+    {
+      k = (nb_bits - i0 < QIM_SEQ_BLOCK) ? nb_bits - i0 : QIM_SEQ_BLOCK;
+      t->i0 = i0;
+      t->k = k;
+      for (c = 0; c < QIM_SEQ_SUMS * nb_chunks; c++)
+	t->sums[c] = 0;
+
+      /* the last pass only adds the last block */
+      pool_run (nb_chunks, seq_task, t);
+      if (!k)
+	break;
+
+      /* the sums of the chunks, in order */
+      for (i = 0; i < k; i++)
+	{
+	  p[i] = 0;
+	  for (l = 0; l <= i; l++)
+	    G[i][l] = 0;
+	}
+      for (c = 0; c < nb_chunks; c++)
+	for (i = 0; i < k; i++)
+	  {
+	    p[i] += t->sums[c * QIM_SEQ_SUMS + i];
+	    for (l = 0; l <= i; l++)
+	      G[i][l] += t->sums[c * QIM_SEQ_SUMS + QIM_SEQ_BLOCK
+				 + i * QIM_SEQ_BLOCK + l];
+	  }
+
+      for (i = 0; i < k; i++)
+	{
+	  norm[i] = normalize ? sqrt (G[i][i]) : 1;
+
+	  /* projection once the previous bits of the block are embedded */
+	  produit = p[i] / norm[i];
+	  for (l = 0; l < i; l++)
+	    produit += a[l] * G[i][l] / norm[i];
+
+	  a[i] = qim_displacement (produit, pas, mot[i0 + i]) / norm[i];
+	}
+
+      t->l0 = i0;
+      t->m = k;
+    }
+
+  free (t->sums);
+}
+
+
+/*****************************************
+ *  Joint embedding                      *
+ *  All the projections are moved at     *
+ *  once to the center of their target   *
+ *  cell: the update sum_l a_l c_l must  *
+ *  satisfy G a = t - p, G being the     *
+ *  Gram matrix of the carriers.         *
+ *****************************************/
+
+/* Cholesky factorization G = L L' in place, on the lower part of G.
+   Returns 0 if G is not positive definite.                          */
+static int
+cholesky (mat G, int n)
+{
+  int i, j, l;
+  double s;
+
+  for (j = 0; j < n; j++)
+    {
+      s = G[j][j];
+      for (l = 0; l < j; l++)
+	s -= G[j][l] * G[j][l];
+      if (s <= 0)
+	return (0);
+      G[j][j] = sqrt (s);
+
+      for (i = j + 1; i < n; i++)
+	{
+	  s = G[i][j];
+	  for (l = 0; l < j; l++)
+	    s -= G[i][l] * G[j][l];
+	  G[i][j] = s / G[j][j];
+	}
+    }
+
+  return (1);
+}
+
+/* a <- (L L')^-1 a */
+static void
+cholesky_solve (mat L, int n, vec a)
+{
+  int i, l;
+  double s;
+
+  for (i = 0; i < n; i++)
+    {
+      s = a[i];
+      for (l = 0; l < i; l++)
+	s -= L[i][l] * a[l];
+      a[i] = s / L[i][i];
+    }
+
+  for (i = n - 1; i >= 0; i--)
+    {
+      s = a[i];
+      for (l = i + 1; l < n; l++)
+	s -= L[l][i] * a[l];
+      a[i] = s / L[i][i];
+    }
+}
+
+/* a such that every projection lands on its target. G holds the lower
+   part of the Gram matrix, diagonal included. If the carriers are not
+   independent (nb_bits > dimension), the bits are embedded one after
+   the other instead.                                                 */
+static void
+qim_joint_coefficients (vec produits, mat G, int *mot, int nb_bits,
+			double pas, vec a)
+{
+  mat L = mat_new (nb_bits, nb_bits);
+  int i;
+
+  mat_copy (L, G);
+  for (i = 0; i < nb_bits; i++)
+    a[i] = qim_displacement (produits[i], pas, mot[i]);
+
+  if (cholesky (L, nb_bits))
+    cholesky_solve (L, nb_bits, a);
+  else
+    {
+      it_warning ("qim: carriers are not independent, embedding the bits "
+		  "sequentially\n");
+      qim_displacements (produits, G, mot, nb_bits, pas, a);
+    }
+
+  mat_delete (L);
+}
+
+
+/*****************************************
+ *  Joint embedding by tiles             *
+ *  The carriers are read twice: once to *
+ *  correlate them with s_X and with     *
+ *  each other, once to add them to s_X. *
+ *  The correlations are summed over     *
+ *  QIM_PARTS parts of the samples,      *
+ *  which are then combined in order.    *
+ *****************************************/
+
+/* number of partial sums of the Gram matrix, combined in order */
+#define QIM_PARTS 32
+
+typedef struct _tiled_loop_
+{
+  vec s_X;
+  qim_source_t src;
+  int nb_bits;
+  int nb_parts;
+  vec *produits;		/* partial <s_X, c_i> of each part  */
+  mat *G;			/* partial Gram matrix of each part */
+  double *a;			/* update coefficients              */
+  double *nrm2;			/* squared norms of the carriers    */
+  double *dot;			/* <s_X, c_i>                       */
+} tiled_loop_t;
+
+/* The samples are split in nb_parts runs of whole tiles */
+static void
+tiled_part (int N_s, int nb_parts, int p, int *j0, int *j1)
+{
+  int nb_tiles = (N_s + QIM_TILE - 1) / QIM_TILE;
+
+  *j0 = (int) ((long long) nb_tiles * p / nb_parts) * QIM_TILE;
+  *j1 = (int) ((long long) nb_tiles * (p + 1) / nb_parts) * QIM_TILE;
+  if (*j1 > N_s)
+    *j1 = N_s;
+}
+
+/* correlations of the carriers with s_X and with each other on part p */
+static void
+tiled_gram_task (void *arg, int p)
+{
+  tiled_loop_t *t = (tiled_loop_t *) arg;
+  double **rows = (double **) malloc (sizeof (double *) * (t->nb_bits + 1));
+  double *buf = source_buffer (&t->src, t->nb_bits);
+  int i, j0, j1, n;
+
+  tiled_part (vec_length (t->s_X), t->nb_parts, p, &j0, &j1);
+
+  for (; j0 < j1; j0 += n)
+    {
+      n = (j1 - j0 < QIM_TILE) ? j1 - j0 : QIM_TILE;
+      source_tile (&t->src, rows, buf, 0, 0, t->nb_bits, j0, n);
+
+      for (i = 0; i < t->nb_bits; i++)
+	__vec_inner_product_many (rows[i], rows, i + 1, n, t->G[p][i]);
+      __vec_inner_product_many (t->s_X + j0, rows, t->nb_bits, n,
+				t->produits[p]);
+    }
+
+  free (buf);
+  free (rows);
+}
+
+/* s_X += sum_i a[i] c_i on the samples of chunk c */
+static void
+tiled_add_task (void *arg, int c)
+{
+  tiled_loop_t *t = (tiled_loop_t *) arg;
+  int N_s = vec_length (t->s_X);
+  double **rows = (double **) malloc (sizeof (double *) * (t->nb_bits + 1));
+  double *buf = source_buffer (&t->src, t->nb_bits);
+  int j0 = c * QIM_CHUNK;
+  int j1 = (N_s - j0 < QIM_CHUNK) ? N_s : j0 + QIM_CHUNK;
+  int n;
+
+  for (; j0 < j1; j0 += n)
+    {
+      n = (j1 - j0 < QIM_TILE) ? j1 - j0 : QIM_TILE;
+      source_tile (&t->src, rows, buf, 0, 0, t->nb_bits, j0, n);
+      __vec_add_many (t->s_X + j0, rows, t->a, t->nb_bits, n);
+    }
+
+  free (buf);
+  free (rows);
+}
+
+/* The keyed carriers are normalized with the diagonal of the Gram
+   matrix; the stored ones are used as they are.                   */
+static void
+tiled_embed_joint (vec s_X, qim_source_t const *src, int *mot, int nb_bits,
+		   double pas, int normalize)
+{
+  int N_s = vec_length (s_X);
+  int nb_tiles = (N_s + QIM_TILE - 1) / QIM_TILE;
+  tiled_loop_t t;
+  vec produits = vec_new_zeros (nb_bits);
+  vec norm = vec_new (nb_bits);
+  vec d = vec_new (nb_bits);
+  mat G = mat_new (nb_bits, nb_bits);
+  int i, l, p;
+
+  t.s_X = s_X;
+  t.src = *src;
+  t.nb_bits = nb_bits;
+  t.nb_parts = (nb_tiles < QIM_PARTS) ? nb_tiles : QIM_PARTS;
+  t.produits = (vec *) malloc (sizeof (vec) * t.nb_parts);
+  t.G = (mat *) malloc (sizeof (mat) * t.nb_parts);
+  t.a = d;
+
+  for (p = 0; p < t.nb_parts; p++)
+    {
+      t.produits[p] = vec_new_zeros (nb_bits);
+      t.G[p] = mat_new (nb_bits, nb_bits);
+      mat_zeros (t.G[p]);
+    }
+
+  pool_run (t.nb_parts, tiled_gram_task, &t);
+
+  mat_zeros (G);
+  for (p = 0; p < t.nb_parts; p++)
+    {
+      for (i = 0; i < nb_bits; i++)
+	{
+	  produits[i] += t.produits[p][i];
+	  for (l = 0; l <= i; l++)
+	    G[i][l] += t.G[p][i][l];
+	}
+      mat_delete (t.G[p]);
+      vec_delete (t.produits[p]);
+    }
+  free (t.G);
+  free (t.produits);
+
+  /* same quantities for the normalized carriers */
+  if (normalize)
+    for (i = 0; i < nb_bits; i++)
+      {
+	norm[i] = sqrt (G[i][i]);
+	produits[i] /= norm[i];
+	for (l = 0; l < i; l++)
+	  G[i][l] /= norm[i] * norm[l];
+	G[i][i] = 1;
+      }
+
+  qim_joint_coefficients (produits, G, mot, nb_bits, pas, d);
+  if (normalize)
+    for (i = 0; i < nb_bits; i++)
+      d[i] /= norm[i];
+
+  pool_run (NB_CHUNKS (N_s), tiled_add_task, &t);
+
+  mat_delete (G);
+  vec_delete (d);
+  vec_delete (norm);
+  vec_delete (produits);
+}
+
+
+/*****************************************
+ *  Stored carriers                      *
+ *****************************************/
+
+int
+qim_embed (vec s_X, vec * carriers, int *mot, int nb_bits, double pas)
+{
+  qim_seq_t t;
+
+  t.s_X = s_X;
+  t.src.carriers = carriers;
+  t.src.packed = NULL;
+  t.src.key = NULL;
+  qim_embed_seq (&t, mot, nb_bits, pas, 0);
+  return (1);
+}
+
+int
+qim_embed_joint (vec s_X, vec * carriers, int *mot, int nb_bits, double pas)
+{
+  vec produits = vec_new (nb_bits);
+  vec a = vec_new (nb_bits);
+  mat G = mat_new (nb_bits, nb_bits);
+
+  qim_project_all (s_X, carriers, nb_bits, produits);
+  qim_gram (carriers, nb_bits, G, 1);
+
+  qim_joint_coefficients (produits, G, mot, nb_bits, pas, a);
+  qim_add_all (s_X, carriers, nb_bits, a);
+
+  mat_delete (G);
+  vec_delete (a);
+  vec_delete (produits);
+  return (1);
+}
+
+int
+qim_detect (vec s_X, vec * carriers, int *mot, int nb_bits, double pas)
+{
+  vec produits = vec_new (nb_bits);
+  int i;
+
+  qim_project_all (s_X, carriers, nb_bits, produits);
+
+  for (i = 0; i < nb_bits; i++)
+    mot[i] = qim_bit (produits[i], pas);
+
+  vec_delete (produits);
+  return (1);
+}
+
+
+/*****************************************
+ *  Orthonormalization                   *
+ *  Block Gram-Schmidt applied twice     *
+ *  (BCGS2): a block of carriers is      *
+ *  projected out of all the previous    *
+ *  ones tile by tile, so that these are *
+ *  read once per block and not once per *
+ *  carrier.                             *
+ *****************************************/
+
+/* number of carriers orthogonalized together */
+#define QIM_ORTHO_BLOCK 8
+
+typedef struct _ortho_loop_
+{
+  vec *Q;			/* orthonormal vectors            */
+  int k;
+  vec *B;			/* vectors to orthogonalize       */
+  int b;
+  mat R;			/* R[m][l] = <B[m], Q[l]>         */
+} ortho_loop_t;
+
+/* R[m][l] for the vectors Q[l] of group g: task m * NB_GROUPS(k) + g */
+static void
+ortho_dot_task (void *arg, int task)
+{
+  ortho_loop_t *t = (ortho_loop_t *) arg;
+  int m = task / NB_GROUPS (t->k);
+  int l0 = (task % NB_GROUPS (t->k)) * QIM_GROUP;
+  int k = (t->k - l0 < QIM_GROUP) ? t->k - l0 : QIM_GROUP;
+  int N_s = vec_length (t->B[m]);
+  double *Qt[QIM_GROUP];
+  int l, j0, n;
+
+  for (j0 = 0; j0 < N_s; j0 += QIM_TILE)
+    {
+      n = (N_s - j0 < QIM_TILE) ? N_s - j0 : QIM_TILE;
+      for (l = 0; l < k; l++)
+	Qt[l] = t->Q[l0 + l] + j0;
+      __vec_inner_product_many (t->B[m] + j0, Qt, k, n, t->R[m] + l0);
+    }
+}
+
+/* B[m] -= sum_l R[m][l] Q[l] on the samples of chunk c */
+static void
+ortho_sub_task (void *arg, int c)
+{
+  ortho_loop_t *t = (ortho_loop_t *) arg;
+  int N_s = vec_length (t->B[0]);
+  int j0 = c * QIM_CHUNK;
+  int n = (N_s - j0 < QIM_CHUNK) ? N_s - j0 : QIM_CHUNK;
+  double **Qt = (double **) malloc (sizeof (double *) * t->k);
+  int l, m, j1, n1;
+
+  for (j1 = j0; j1 < j0 + n; j1 += QIM_TILE)
+    {
+      n1 = (j0 + n - j1 < QIM_TILE) ? j0 + n - j1 : QIM_TILE;
+      for (l = 0; l < t->k; l++)
+	Qt[l] = t->Q[l] + j1;
+      for (m = 0; m < t->b; m++)
+	__vec_add_many (t->B[m] + j1, Qt, t->R[m], t->k, n1);
+    }
+
+  free (Qt);
+}
+
+/* B[m] -= sum_l <B[m], Q[l]> Q[l], for the b vectors of B and the k
+   orthonormal vectors of Q                                          */
+static void
+ortho_project_out (vec * Q, int k, vec * B, int b)
+{
+  ortho_loop_t t;
+  int m, l;
+
+  if (k == 0)
+    return;
+
+  t.Q = Q;
+  t.k = k;
+  t.B = B;
+  t.b = b;
+  t.R = mat_new (b, k);
+  mat_zeros (t.R);
+
+  pool_run (b * NB_GROUPS (k), ortho_dot_task, &t);
+
+  for (m = 0; m < b; m++)
+    for (l = 0; l < k; l++)
+      t.R[m][l] = -t.R[m][l];
+
+  pool_run (NB_CHUNKS (vec_length (B[0])), ortho_sub_task, &t);
+
+  mat_delete (t.R);
+}
+
+int
+qim_orthonormalize (vec * carriers, int nb_bits)
+{
+  int i, b, m;
+
+  for (i = 0; i < nb_bits; i += b)
+    {
+      b = (nb_bits - i < QIM_ORTHO_BLOCK) ? nb_bits - i : QIM_ORTHO_BLOCK;
+
+      /* against the previous blocks */
+      ortho_project_out (carriers, i, carriers + i, b);
+      ortho_project_out (carriers, i, carriers + i, b);
+
+      /* within the block */
+      for (m = 0; m < b; m++)
+	{
+	  ortho_project_out (carriers + i, m, carriers + i + m, 1);
+	  ortho_project_out (carriers + i, m, carriers + i + m, 1);
+	  vec_normalize (carriers[i + m], 2);
+	}
+    }
+
+  return (1);
+}
+
+
+/*****************************************
+ *  Compact carriers                     *
+ *  float, or signed char times a scale  *
+ *  per carrier. The products are summed *
+ *  in double.                           *
+ *****************************************/
+
+/* int8 step of a carrier: its largest sample maps to 127 */
+static double
+i8_scale (vec c)
+{
+  double m = 0;
+  int j;
+
+  for (j = 0; j < vec_length (c); j++)
+    if (fabs (c[j]) > m)
+      m = fabs (c[j]);
+
+  return ((m > 0) ? m / 127 : 1);
+}
+
+static signed char
+i8_quantize (double x, double scale)
+{
+  double q = floor (x / scale + 0.5);
+
+  if (q > 127)
+    q = 127;
+  if (q < -127)
+    q = -127;
+
+  return ((signed char) q);
+}
+
+/* nb_bits carriers of dim samples of the type, to be filled */
+static qim_packed_t *
+packed_new (int nb_bits, int dim, int type)
+{
+  qim_packed_t *p = (qim_packed_t *) malloc (sizeof (qim_packed_t));
+  size_t size = (type == QIM_F32) ? sizeof (float) : 1;
+  int i;
+
+  it_assert (type == QIM_F32 || type == QIM_I8,
+	     "qim_pack: unsupported carrier type");
+
+  p->type = type;
+  p->nb_bits = nb_bits;
+  p->dim = dim;
+  p->data = (void **) malloc (sizeof (void *) * (nb_bits + 1));
+  p->scale = (double *) malloc (sizeof (double) * (nb_bits + 1));
+
+  for (i = 0; i < nb_bits; i++)
+    {
+      p->data[i] = malloc (size * dim);
+      p->scale[i] = 1;
+    }
+
+  return (p);
+}
+
+/* carrier i of p from its samples in double */
+static void
+packed_set (qim_packed_t * p, int i, vec c)
+{
+  int j;
+
+  assert (vec_length (c) == p->dim);
+
+  if (p->type == QIM_F32)
+    {
+      float *f = (float *) p->data[i];
+
+      for (j = 0; j < p->dim; j++)
+	f[j] = (float) c[j];
+    }
+  else
+    {
+      signed char *q = (signed char *) p->data[i];
+
+      p->scale[i] = i8_scale (c);
+      for (j = 0; j < p->dim; j++)
+	q[j] = i8_quantize (c[j], p->scale[i]);
+    }
+}
+
+qim_packed_t *
+qim_pack (vec * carriers, int nb_bits, int type)
+{
+  int dim = (nb_bits > 0) ? vec_length (carriers[0]) : 0;
+  qim_packed_t *p = packed_new (nb_bits, dim, type);
+  int i;
+
+  for (i = 0; i < nb_bits; i++)
+    packed_set (p, i, carriers[i]);
+
+  return (p);
+}
+
+qim_packed_t *
+qim_packed_randn (int nb_bits, int dim, int type, int ortho)
+{
+  qim_packed_t *p;
+  vec *carriers;
+  vec c;
+  int i;
+
+  if (ortho)
+    {
+      carriers = (vec *) malloc (sizeof (vec) * (nb_bits + 1));
+      for (i = 0; i < nb_bits; i++)
+	{
+	  carriers[i] = vec_new (dim);
+	  vec_randn (carriers[i]);
+	  vec_normalize (carriers[i], 2);
+	}
+
+      qim_orthonormalize (carriers, nb_bits);
+      p = qim_pack (carriers, nb_bits, type);
+
+      for (i = 0; i < nb_bits; i++)
+	vec_delete (carriers[i]);
+      free (carriers);
+      return (p);
+    }
+
+  p = packed_new (nb_bits, dim, type);
+  c = vec_new (dim);
+
+  for (i = 0; i < nb_bits; i++)
+    {
+      vec_randn (c);
+      vec_normalize (c, 2);
+      packed_set (p, i, c);
+    }
+
+  vec_delete (c);
+  return (p);
+}
+
+void
+qim_packed_delete (qim_packed_t * p)
+{
+  int i;
+
+  for (i = 0; i < p->nb_bits; i++)
+    free (p->data[i]);
+
+  free (p->scale);
+  free (p->data);
+  free (p);
+}
+
+/* p[i] += sum_j v[j] w[i][j], for k float carriers, in double */
+static void
+inner_product_many_f32 (const double *v, float *const *w, int k, int n,
+			double *p)
+{
+  int i, j;
+
+  for (i = 0; i + 4 <= k; i += 4)
+    {
+      const float *w0 = w[i], *w1 = w[i + 1], *w2 = w[i + 2], *w3 = w[i + 3];
+      double p0 = 0, p1 = 0, p2 = 0, p3 = 0;
+
+      for (j = 0; j < n; j++)
+	{
+	  double x = v[j];
+	  p0 += x * w0[j];
+	  p1 += x * w1[j];
+	  p2 += x * w2[j];
+	  p3 += x * w3[j];
+	}
+
+      p[i] += p0;
+      p[i + 1] += p1;
+      p[i + 2] += p2;
+      p[i + 3] += p3;
+    }
+
+  for (; i < k; i++)
+    {
+      const float *w0 = w[i];
+      double p0 = 0;
+
+      for (j = 0; j < n; j++)
+	p0 += v[j] * w0[j];
+      p[i] += p0;
+    }
+}
+
+/* Same for int8 carriers, the scale being applied by the caller */
+static void
+inner_product_many_i8 (const double *v, signed char *const *w, int k, int n,
+		       double *p)
+{
+  int i, j;
+
+  for (i = 0; i + 4 <= k; i += 4)
+    {
+      const signed char *w0 = w[i], *w1 = w[i + 1];
+      const signed char *w2 = w[i + 2], *w3 = w[i + 3];
+      double p0 = 0, p1 = 0, p2 = 0, p3 = 0;
+
+      for (j = 0; j < n; j++)
+	{
+	  double x = v[j];
+	  p0 += x * w0[j];
+	  p1 += x * w1[j];
+	  p2 += x * w2[j];
+	  p3 += x * w3[j];
+	}
+
+      p[i] += p0;
+      p[i + 1] += p1;
+      p[i + 2] += p2;
+      p[i + 3] += p3;
+    }
+
+  for (; i < k; i++)
+    {
+      const signed char *w0 = w[i];
+      double p0 = 0;
+
+      for (j = 0; j < n; j++)
+	p0 += v[j] * w0[j];
+      p[i] += p0;
+    }
+}
+
+typedef struct _packed_loop_
+{
+  vec s_X;
+  qim_packed_t *p;
+  double *produits;
+} packed_loop_t;
+
+/* projections on the carriers of group g, one tile of s_X at a time */
+static void
+packed_project_task (void *arg, int g)
+{
+  packed_loop_t *t = (packed_loop_t *) arg;
+  qim_packed_t *p = t->p;
+  int i0 = g * QIM_GROUP;
+  int k = (p->nb_bits - i0 < QIM_GROUP) ? p->nb_bits - i0 : QIM_GROUP;
+  void *w[QIM_GROUP];
+  int i, j0, n;
+
+  for (i = 0; i < k; i++)
+    t->produits[i0 + i] = 0;
+
+  for (j0 = 0; j0 < p->dim; j0 += QIM_TILE)
+    {
+      n = (p->dim - j0 < QIM_TILE) ? p->dim - j0 : QIM_TILE;
+
+      if (p->type == QIM_F32)
+	{
+	  for (i = 0; i < k; i++)
+	    w[i] = (float *) p->data[i0 + i] + j0;
+	  inner_product_many_f32 (t->s_X + j0, (float **) w, k, n,
+				  t->produits + i0);
+	}
+      else
+	{
+	  for (i = 0; i < k; i++)
+	    w[i] = (signed char *) p->data[i0 + i] + j0;
+	  inner_product_many_i8 (t->s_X + j0, (signed char **) w, k, n,
+				 t->produits + i0);
+	}
+    }
+
+  for (i = 0; i < k; i++)
+    t->produits[i0 + i] *= p->scale[i0 + i];
+}
+
+int
+qim_detect_packed (vec s_X, qim_packed_t * p, int *mot, double pas)
+{
+  vec produits = vec_new (p->nb_bits);
+  packed_loop_t t;
+  int i;
+
+  assert (vec_length (s_X) == p->dim);
+
+  t.s_X = s_X;
+  t.p = p;
+  t.produits = produits;
+  pool_run (NB_GROUPS (p->nb_bits), packed_project_task, &t);
+
+  for (i = 0; i < p->nb_bits; i++)
+    mot[i] = qim_bit (produits[i], pas);
+
+  vec_delete (produits);
+  return (1);
+}
+
+/* the carriers are converted to double tile by tile */
+int
+qim_embed_packed (vec s_X, qim_packed_t * p, int *mot, double pas)
+{
+  qim_seq_t t;
+
+  assert (vec_length (s_X) == p->dim);
+
+  t.s_X = s_X;
+  t.src.carriers = NULL;
+  t.src.packed = p;
+  t.src.key = NULL;
+  qim_embed_seq (&t, mot, p->nb_bits, pas, 0);
+  return (1);
+}
+
+int
+qim_embed_joint_packed (vec s_X, qim_packed_t * p, int *mot, double pas)
+{
+  qim_source_t src = { NULL, p, NULL };
+
+  assert (vec_length (s_X) == p->dim);
+
+  tiled_embed_joint (s_X, &src, mot, p->nb_bits, pas, 0);
+  return (1);
+}
+
+
+/*****************************************
+ *  Streamed carriers                    *
+ *  The carriers come one after the      *
+ *  other from the MT19937 generator. A  *
+ *  first sweep moves the generator past *
+ *  QIM_GROUP carriers, keeping a        *
+ *  snapshot at the start of each, and   *
+ *  the carriers are then replayed from  *
+ *  their snapshots in parallel.         *
+ *****************************************/
+
+typedef struct _qim_stream_
+{
+  vec s_X;			/* host vector                      */
+  mt19937_state_t *marks;	/* generator at the start of each   */
+  vec *carriers;		/* drawn carriers, when embedding   */
+  double *produits;		/* projections, when detecting      */
+} qim_stream_t;
+
+/* snapshots of the next k carriers of N_s samples, leaving the
+   generator after them                                          */
+static void
+stream_marks (mt19937_state_t * marks, int k, int N_s)
+{
+  int i;
+
+  for (i = 0; i < k; i++)
+    {
+      mt19937_get_state (&marks[i]);
+      mt19937_randn_skip (N_s);
+    }
+}
+
+/* produits[i] = <s_X, c_i> / ||c_i||, both sums taken in one replay */
+static void
+stream_correlate_task (void *arg, int i)
+{
+  qim_stream_t *t = (qim_stream_t *) arg;
+  int N_s = vec_length (t->s_X);
+  double *blk = (double *) malloc (sizeof (double) * QIM_BLOCK);
+  double s = 0, p = 0;
+  int j, j0, n;
+
+  for (j0 = 0; j0 < N_s; j0 += QIM_BLOCK)
+    {
+      n = (N_s - j0 < QIM_BLOCK) ? N_s - j0 : QIM_BLOCK;
+      mt19937_randn_fill (&t->marks[i], blk, n);
+      for (j = 0; j < n; j++)
+	{
+	  s += blk[j] * blk[j];
+	  p += t->s_X[j0 + j] * blk[j];
+	}
+    }
+
+  t->produits[i] = p / sqrt (s);
+  free (blk);
+}
+
+static void
+stream_draw_task (void *arg, int i)
+{
+  qim_stream_t *t = (qim_stream_t *) arg;
+
+  mt19937_randn_fill (&t->marks[i], t->carriers[i],
+		      vec_length (t->carriers[i]));
+}
+
+/* The carriers of a group are drawn in memory, then embedded by the
+   sequential engine, which normalizes them.                          */
+int
+qim_embed_stream (vec s_X, int *mot, int nb_bits, double pas)
+{
+  int N_s = vec_length (s_X);
+  vec carriers[QIM_GROUP];
+  mt19937_state_t *marks;
+  qim_stream_t t;
+  qim_seq_t seq;
+  int i, i0, k;
+
+  marks = (mt19937_state_t *) malloc (sizeof (mt19937_state_t) * QIM_GROUP);
+  for (i = 0; i < QIM_GROUP; i++)
+    carriers[i] = vec_new (N_s);
+
+  t.s_X = s_X;
+  t.marks = marks;
+  t.carriers = carriers;
+  t.produits = NULL;
+
+  seq.s_X = s_X;
+  seq.src.carriers = carriers;
+  seq.src.packed = NULL;
+  seq.src.key = NULL;
+
+  for (i0 = 0; i0 < nb_bits; i0 += k)
+    {
+      k = (nb_bits - i0 < QIM_GROUP) ? nb_bits - i0 : QIM_GROUP;
+      stream_marks (marks, k, N_s);
+      pool_run (k, stream_draw_task, &t);
+      qim_embed_seq (&seq, mot + i0, k, pas, 1);
+    }
+
+  for (i = 0; i < QIM_GROUP; i++)
+    vec_delete (carriers[i]);
+  free (marks);
+  return (1);
+}
+
+int
+qim_detect_stream (vec s_X, int *mot, int nb_bits, double pas)
+{
+  int N_s = vec_length (s_X);
+  double produits[QIM_GROUP];
+  mt19937_state_t *marks;
+  qim_stream_t t;
+  int i, i0, k;
+
+  marks = (mt19937_state_t *) malloc (sizeof (mt19937_state_t) * QIM_GROUP);
+
+  t.s_X = s_X;
+  t.marks = marks;
+  t.carriers = NULL;
+  t.produits = produits;
+
+  for (i0 = 0; i0 < nb_bits; i0 += k)
+    {
+      k = (nb_bits - i0 < QIM_GROUP) ? nb_bits - i0 : QIM_GROUP;
+      stream_marks (marks, k, N_s);
+      pool_run (k, stream_correlate_task, &t);
+      for (i = 0; i < k; i++)
+	mot[i0 + i] = qim_bit (produits[i], pas);
+    }
+
+  free (marks);
+  return (1);
+}
+
+
+/*****************************************
+ *  Keyed carriers                       *
+ *  Carrier i is the stream i of the     *
+ *  counter-based generator keyed by     *
+ *  key: any block of any carrier can be *
+ *  drawn directly.                      *
+ *****************************************/
+
+/* norms and projections of the carriers of group g */
+static void
+keyed_detect_task (void *arg, int g)
+{
+  tiled_loop_t *t = (tiled_loop_t *) arg;
+  int N_s = vec_length (t->s_X);
+  int i0 = g * QIM_GROUP;
+  int k = (t->nb_bits - i0 < QIM_GROUP) ? t->nb_bits - i0 : QIM_GROUP;
+  double *buf = source_buffer (&t->src, k);
+  double *rows[QIM_GROUP];
+  int i, j, j0, n;
+
+  for (j0 = 0; j0 < N_s; j0 += QIM_TILE)
+    {
+      n = (N_s - j0 < QIM_TILE) ? N_s - j0 : QIM_TILE;
+      source_tile (&t->src, rows, buf, 0, i0, k, j0, n);
+
+      for (i = 0; i < k; i++)
+	for (j = 0; j < n; j++)
+	  t->nrm2[i0 + i] += rows[i][j] * rows[i][j];
+      __vec_inner_product_many (t->s_X + j0, rows, k, n, t->dot + i0);
+    }
+
+  free (buf);
+}
+
+/* The generator is run twice over every carrier, as a carrier of a
+   block and then of the previous block.                            */
+int
+qim_embed_keyed (vec s_X, unsigned int const key[4], int *mot, int nb_bits,
+		 double pas)
+{
+  qim_seq_t t;
+
+  t.s_X = s_X;
+  t.src.carriers = NULL;
+  t.src.packed = NULL;
+  t.src.key = key;
+  qim_embed_seq (&t, mot, nb_bits, pas, 1);
+  return (1);
+}
+
+int
+qim_embed_keyed_joint (vec s_X, unsigned int const key[4], int *mot,
+		       int nb_bits, double pas)
+{
+  qim_source_t src = { NULL, NULL, key };
+
+  tiled_embed_joint (s_X, &src, mot, nb_bits, pas, 1);
+  return (1);
+}
+
+/* The carriers are independent streams: each group of carriers is drawn
+   tile by tile and correlated with the same tile of s_X.               */
+int
+qim_detect_keyed (vec s_X, unsigned int const key[4], int *mot, int nb_bits,
+		  double pas)
+{
+  tiled_loop_t t;
+  vec dot = vec_new_zeros (nb_bits);
+  vec nrm2 = vec_new_zeros (nb_bits);
+  int i;
+
+  t.s_X = s_X;
+  t.src.carriers = NULL;
+  t.src.packed = NULL;
+  t.src.key = key;
+  t.nb_bits = nb_bits;
+  t.dot = dot;
+  t.nrm2 = nrm2;
+
+  pool_run (NB_GROUPS (nb_bits), keyed_detect_task, &t);
+
+  for (i = 0; i < nb_bits; i++)
+    mot[i] = qim_bit (dot[i] / sqrt (nrm2[i]), pas);
+
+  vec_delete (nrm2);
+  vec_delete (dot);
+  return (1);
+}
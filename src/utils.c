@@ -45,6 +45,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "../include/random.h"
 
 #include "../include/constants.h"
+#include "../include/antipodal.h"
 #include "../include/utils.h"
 
 
@@ -59,21 +60,9 @@ proportionalEmbed (vec v_W, unsigned int *alea, vec s_X_abs, vec s_W)
   int N_s = vec_length (s_W);
   int N_v = vec_length (v_W);
   double pos = 1 / sqrt (N_s);
-  int i, j, k = 0;
-
-  for (i = 0; i < N_v; i++)
-    for (j = 0; j < N_s; j++)
-      {
-	if ((alea[k / 32] & (1 << (k % 32))) != 0)
-	  {
-	    s_W[j] += v_W[i];
-	  }
-	else
-	  {
-	    s_W[j] -= v_W[i];
-	  }
-	k++;
-      }
+  int j;
+
+  antipodal_embed (v_W, N_v, alea, s_W, N_s);
 
   for (j = 0; j < N_s; j++)
     s_W[j] = s_W[j] * s_X_abs[j] * pos; /* Eq. (23) of the paper */
@@ -92,23 +81,11 @@ constantEmbed (vec v_W, unsigned int *alea, vec s_W)
 {
   int N_s = vec_length (s_W);
   int N_v = vec_length (v_W);
-  int i, j, k = 0;
+  int j;
   double pos = 1 / sqrt (N_s);
 
 
-  for (i = 0; i < N_v; i++)
-    for (j = 0; j < N_s; j++)
-      {
-	if ((alea[k / 32] & (1 << (k % 32))) != 0)
-	  {
-	    s_W[j] += v_W[i];
-	  }
-	else
-	  {
-	    s_W[j] -= v_W[i];
-	  }
-	k++;
-      }
+  antipodal_embed (v_W, N_v, alea, s_W, N_s);
 
   for (j = 0; j < N_s; j++)
     s_W[j] = s_W[j] * pos;
@@ -27,9 +27,18 @@
 #include "../include/vec.h"
 #include "../include/io.h"
 #include "../include/random.h"
+#include "../include/arena.h"
+#include "../include/blas.h"
 
 #include "../include/constants.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 /*---------------------------------------------------------------------------*/
 /*                Constant vectors                                           */
 /*---------------------------------------------------------------------------*/
@@ -72,16 +81,39 @@ cvec const cvec_null = (cvec) (&__cvec_null + 1);
 /*                Vector allocation functions                                */
 /*---------------------------------------------------------------------------*/
 
+unsigned long Vec_alloc_count = 0;
+size_t Vec_alloc_bytes = 0;
+
+void Vec_alloc_account(size_t bytes)
+{
+#if defined(_MSC_VER)
+  _InterlockedIncrement((long volatile *) &Vec_alloc_count);
+#ifdef _WIN64
+  _InterlockedExchangeAdd64((__int64 volatile *) &Vec_alloc_bytes, (__int64) bytes);
+#else
+  _InterlockedExchangeAdd((long volatile *) &Vec_alloc_bytes, (long) bytes);
+#endif
+#else
+  __atomic_fetch_add(&Vec_alloc_count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&Vec_alloc_bytes, bytes, __ATOMIC_RELAXED);
+#endif
+}
+
 void *__Vec_new_alloc(size_t elem_size, idx_t length, idx_t length_max) 
 {
   Vec_header_t *hdr;
-  char *ptr, *aligned;
+  char *ptr, *owner, *aligned;
+  size_t size;
   int padding;
 
   /* allocate a vector of size 'length_max' with some extra room 
-     for the header and padding                                  */
-  ptr = (char *) malloc(sizeof(Vec_header_t) + length_max * elem_size + IT_ALLOC_ALIGN);
+     for the header and padding, in the arena of the thread if any */
+  size = sizeof(Vec_header_t) + length_max * elem_size + IT_ALLOC_ALIGN;
+  owner = NULL;
+  if(!(ptr = (char *) it_arena_alloc(size)))
+    ptr = owner = (char *) malloc(size);
   it_assert( ptr, "No enough memory to allocate the vector" );
+  Vec_alloc_account(length_max * elem_size);
 
   /* make sure the first element is properly aligned */
   aligned = ptr + sizeof(Vec_header_t) + IT_ALLOC_ALIGN - 1;
@@ -91,7 +123,7 @@ void *__Vec_new_alloc(size_t elem_size, idx_t length, idx_t length_max)
   hdr = (Vec_header_t *) aligned - 1;
   hdr->length = length;
   hdr->length_max = length_max;
-  hdr->ptr = ptr;
+  hdr->ptr = owner;
   hdr->element_size = elem_size;
   return(aligned);
 }
@@ -490,10 +522,8 @@ void vec_decr( vec v, double a )
 
 void vec_mul_by( vec v, double a )  
 {
-  idx_t i;
   assert( v );
-  for( i = 0 ; i < vec_length( v ) ; i++ )
-    v[ i ] *= a;
+  blas_scale( v, a, vec_length( v ) );
 }
 
 
@@ -638,23 +668,19 @@ void cvec_div_by( cvec v, cplx a )
 /* Components per components operations (vectors must be of same size)    */
 void vec_add( vec v1, vec v2 )  
 {
-  idx_t i;
   assert( v1 );
   assert( v2 );
   assert( vec_length( v1 ) == vec_length( v2 ) );
-  for( i = 0 ; i < vec_length( v1 ) ; i++ )
-    v1[ i ] += v2[ i ];
+  blas_add( v1, v2, vec_length( v1 ) );
 }
 
 
 void vec_sub( vec v1, vec v2 )  
 {
-  idx_t i;
   assert( v1 );
   assert( v2 );
   assert( vec_length( v1 ) == vec_length( v2 ) );
-  for( i = 0 ; i < vec_length( v1 ) ; i++ )
-    v1[ i ] -= v2[ i ];
+  blas_sub( v1, v2, vec_length( v1 ) );
 }
 
 
@@ -836,14 +862,274 @@ ivec ivec_new_div( ivec v1, ivec v2 )
 /*------------------------------------------------------------------------------*/
 double vec_inner_product( vec v1, vec v2 )  
 {
-  double p = 0;
-  idx_t i;
   assert( v1 );
   assert( v2 );
   assert( vec_length( v1 ) == vec_length( v2 ) );
-  for( i = 0 ; i < vec_length( v1 ) ; i++ )
-    p += v1[ i ] * v2[ i ];
-  return p;
+  return blas_dot( v1, v2, vec_length( v1 ) );
+}
+
+
+/*------------------------------------------------------------------------------*/
+/* Number of elements of v kept in cache while they are multiplied by all the w */
+#define VEC_IP_TILE 1024
+
+void __vec_inner_product_many( const double * v, double ** w, idx_t k,
+			       idx_t n, double * p )
+{
+  idx_t i, j, j0, j1;
+
+  for( j0 = 0 ; j0 < n ; j0 = j1 ) {
+    j1 = ( n - j0 < VEC_IP_TILE ) ? n : j0 + VEC_IP_TILE;
+    i = 0;
+
+#ifdef __SSE2__
+    /* 8 vectors at a time, two per register. The lanes hold different
+       vectors, so that each sum is still made in the order of j.       */
+    for( ; i + 8 <= k ; i += 8 ) {
+      const double * w0 = w[ i ], * w1 = w[ i + 1 ], * w2 = w[ i + 2 ];
+      const double * w3 = w[ i + 3 ], * w4 = w[ i + 4 ], * w5 = w[ i + 5 ];
+      const double * w6 = w[ i + 6 ], * w7 = w[ i + 7 ];
+      __m128d a0 = _mm_loadu_pd( p + i );
+      __m128d a1 = _mm_loadu_pd( p + i + 2 );
+      __m128d a2 = _mm_loadu_pd( p + i + 4 );
+      __m128d a3 = _mm_loadu_pd( p + i + 6 );
+
+      for( j = j0 ; j < j1 ; j++ ) {
+	__m128d x = _mm_set1_pd( v[ j ] );
+	a0 = _mm_add_pd( a0, _mm_mul_pd( x, _mm_set_pd( w1[ j ], w0[ j ] ) ) );
+	a1 = _mm_add_pd( a1, _mm_mul_pd( x, _mm_set_pd( w3[ j ], w2[ j ] ) ) );
+	a2 = _mm_add_pd( a2, _mm_mul_pd( x, _mm_set_pd( w5[ j ], w4[ j ] ) ) );
+	a3 = _mm_add_pd( a3, _mm_mul_pd( x, _mm_set_pd( w7[ j ], w6[ j ] ) ) );
+      }
+
+      _mm_storeu_pd( p + i, a0 );
+      _mm_storeu_pd( p + i + 2, a1 );
+      _mm_storeu_pd( p + i + 4, a2 );
+      _mm_storeu_pd( p + i + 6, a3 );
+    }
+#endif
+
+    for( ; i + 4 <= k ; i += 4 ) {
+      const double * w0 = w[ i ], * w1 = w[ i + 1 ];
+      const double * w2 = w[ i + 2 ], * w3 = w[ i + 3 ];
+      double p0 = p[ i ], p1 = p[ i + 1 ], p2 = p[ i + 2 ], p3 = p[ i + 3 ];
+
+      for( j = j0 ; j < j1 ; j++ ) {
+	double x = v[ j ];
+	p0 += x * w0[ j ];
+	p1 += x * w1[ j ];
+	p2 += x * w2[ j ];
+	p3 += x * w3[ j ];
+      }
+
+      p[ i ] = p0;
+      p[ i + 1 ] = p1;
+      p[ i + 2 ] = p2;
+      p[ i + 3 ] = p3;
+    }
+
+    for( ; i < k ; i++ ) {
+      const double * w0 = w[ i ];
+      double p0 = p[ i ];
+
+      for( j = j0 ; j < j1 ; j++ )
+	p0 += v[ j ] * w0[ j ];
+      p[ i ] = p0;
+    }
+  }
+}
+
+
+/*------------------------------------------------------------------------------*/
+void vec_inner_product_many( vec v, vec * w, idx_t k, double * p )
+{
+  idx_t i;
+  assert( v );
+  assert( w );
+  assert( p );
+
+  for( i = 0 ; i < k ; i++ ) {
+    assert( vec_length( w[ i ] ) == vec_length( v ) );
+    p[ i ] = 0;
+  }
+
+  __vec_inner_product_many( v, w, k, vec_length( v ), p );
+}
+
+
+/*------------------------------------------------------------------------------*/
+void __vec_add_many( double * v, double ** w, const double * a, idx_t k,
+		     idx_t n )
+{
+  idx_t i, j, j0, j1;
+
+  for( j0 = 0 ; j0 < n ; j0 = j1 ) {
+    j1 = ( n - j0 < VEC_IP_TILE ) ? n : j0 + VEC_IP_TILE;
+
+    /* 4 vectors per pass over the tile, which stays in cache */
+    for( i = 0 ; i + 4 <= k ; i += 4 ) {
+      const double * w0 = w[ i ], * w1 = w[ i + 1 ];
+      const double * w2 = w[ i + 2 ], * w3 = w[ i + 3 ];
+      double a0 = a[ i ], a1 = a[ i + 1 ], a2 = a[ i + 2 ], a3 = a[ i + 3 ];
+
+      j = j0;
+#ifdef __SSE2__
+      {
+	__m128d b0 = _mm_set1_pd( a0 ), b1 = _mm_set1_pd( a1 );
+	__m128d b2 = _mm_set1_pd( a2 ), b3 = _mm_set1_pd( a3 );
+
+	for( ; j + 2 <= j1 ; j += 2 ) {
+	  __m128d x = _mm_loadu_pd( v + j );
+	  x = _mm_add_pd( x, _mm_mul_pd( _mm_loadu_pd( w0 + j ), b0 ) );
+	  x = _mm_add_pd( x, _mm_mul_pd( _mm_loadu_pd( w1 + j ), b1 ) );
+	  x = _mm_add_pd( x, _mm_mul_pd( _mm_loadu_pd( w2 + j ), b2 ) );
+	  x = _mm_add_pd( x, _mm_mul_pd( _mm_loadu_pd( w3 + j ), b3 ) );
+	  _mm_storeu_pd( v + j, x );
+	}
+      }
+#endif
+      for( ; j < j1 ; j++ ) {
+	double x = v[ j ];
+	x += w0[ j ] * a0;
+	x += w1[ j ] * a1;
+	x += w2[ j ] * a2;
+	x += w3[ j ] * a3;
+	v[ j ] = x;
+      }
+    }
+
+    for( ; i < k ; i++ ) {
+      const double * w0 = w[ i ];
+      double a0 = a[ i ];
+
+      for( j = j0 ; j < j1 ; j++ )
+	v[ j ] += w0[ j ] * a0;
+    }
+  }
+}
+
+
+/*------------------------------------------------------------------------------*/
+void vec_add_many( vec v, vec * w, const double * a, idx_t k )
+{
+  idx_t i;
+  assert( v );
+  assert( w );
+  assert( a );
+
+  for( i = 0 ; i < k ; i++ )
+    assert( vec_length( w[ i ] ) == vec_length( v ) );
+
+  __vec_add_many( v, w, a, k, vec_length( v ) );
+}
+
+
+/*------------------------------------------------------------------------------*/
+void vec_axpy( vec y, double a, vec x )
+{
+  assert( y );
+  assert( x );
+  assert( vec_length( y ) == vec_length( x ) );
+  blas_axpy( y, a, x, vec_length( y ) );
+}
+
+
+void vec_axpby( vec y, double a, vec x, double b )
+{
+  assert( y );
+  assert( x );
+  assert( vec_length( y ) == vec_length( x ) );
+  blas_axpby( y, a, x, b, vec_length( y ) );
+}
+
+
+double vec_axpy_dot( vec y, double a, vec x, vec z )
+{
+  assert( y );
+  assert( x );
+  assert( z );
+  assert( vec_length( y ) == vec_length( x ) );
+  assert( vec_length( y ) == vec_length( z ) );
+  return blas_axpy_dot( y, a, x, z, vec_length( y ) );
+}
+
+
+double vec_axpy_norm( vec y, double a, vec x )
+{
+  assert( y );
+  assert( x );
+  assert( vec_length( y ) == vec_length( x ) );
+  return sqrt( blas_axpy_dot( y, a, x, y, vec_length( y ) ) );
+}
+
+
+/*------------------------------------------------------------------------------*/
+/* Views                                                                        */
+idx_t vec_view_to_vec( vec_view s, vec v, idx_t idx )
+{
+  idx_t i;
+  assert( v );
+  assert( idx >= 0 && idx + s.length <= vec_length( v ) );
+
+  if( s.stride == 1 )
+    memcpy( v + idx, s.data, s.length * sizeof( double ) );
+  else
+    for( i = 0 ; i < s.length ; i++ )
+      v[ idx + i ] = _vec_view( s, i );
+  return idx + s.length;
+}
+
+
+idx_t vec_to_vec_view( vec v, idx_t idx, vec_view s )
+{
+  idx_t i;
+  assert( v );
+  assert( idx >= 0 && idx + s.length <= vec_length( v ) );
+
+  if( s.stride == 1 )
+    memcpy( s.data, v + idx, s.length * sizeof( double ) );
+  else
+    for( i = 0 ; i < s.length ; i++ )
+      _vec_view( s, i ) = v[ idx + i ];
+  return idx + s.length;
+}
+
+
+void vec_view_copy( vec_view dst, vec_view src )
+{
+  idx_t i;
+  assert( dst.length == src.length );
+
+  if( dst.stride == 1 && src.stride == 1 )
+    memmove( dst.data, src.data, src.length * sizeof( double ) );
+  else
+    for( i = 0 ; i < src.length ; i++ )
+      _vec_view( dst, i ) = _vec_view( src, i );
+}
+
+
+void vec_view_mul_by( vec_view s, double a )
+{
+  idx_t i;
+
+  if( s.stride == 1 )
+    blas_scale( s.data, a, s.length );
+  else
+    for( i = 0 ; i < s.length ; i++ )
+      _vec_view( s, i ) *= a;
+}
+
+
+void vec_view_axpy( vec_view y, double a, vec_view x )
+{
+  idx_t i;
+  assert( y.length == x.length );
+
+  if( y.stride == 1 && x.stride == 1 )
+    blas_axpy( y.data, a, x.data, y.length );
+  else
+    for( i = 0 ; i < y.length ; i++ )
+      _vec_view( y, i ) += a * _vec_view( x, i );
 }
 
 
@@ -991,17 +1277,19 @@ void vec_normalize( vec v, double nr )
   double s = 0;
   assert( v );
 
-  /* For optimization purpose, the norm 1 is treated separately */
+  /* For optimization purpose, the norm 1 is treated separately, and the
+     norm 2 too when the sums need not be those of the previous versions */
   if( nr == 1 )
     s = vec_sum( v );
+  else if( nr == 2 && blas_mode() == BLAS_BLOCKED )
+    s = sqrt( blas_sum_sqr( v, vec_length( v ) ) );
   else {
     for( i = 0 ; i < vec_length( v ) ; i++ )
       s += pow( fabs( v[ i ] ), nr );
     s = pow( s, 1.0 / nr );
   }
 
-  for( i = 0 ; i < vec_length( v ) ; i++ )
-    v[ i ] /= s;
+  blas_div( v, s, vec_length( v ) );
 }
 
 
@@ -1088,12 +1376,8 @@ int ivec_median( ivec v )
 /*------------------------------------------------------------------------------*/
 double vec_sum( vec v )  
 {
-  idx_t i;
-  double s = 0;
   assert( v );
-  for( i = 0 ; i < Vec_length( v ) ; i++ )
-    s += v[ i ];
-  return s;
+  return blas_sum( v, Vec_length( v ) );
 }
 
 
@@ -1176,12 +1460,8 @@ cvec cvec_cum_sum( cvec v )
 
 double vec_sum_sqr( vec v )  
 {
-  idx_t i;
-  double s = 0;
   assert( v );
-  for( i = 0 ; i < Vec_length( v ) ; i++ )
-    s += v[ i ] * v[ i ];
-  return s;
+  return blas_sum_sqr( v, Vec_length( v ) );
 }
 
 
@@ -1306,16 +1586,13 @@ double vec_median( vec v )
 
 double vec_variance( vec v ) 
 {
-  idx_t i, l;
-  double sum = 0;
-  double var = 0;
+  idx_t l;
+  double sum, var;
   assert( v );
   l = Vec_length( v );
   assert( l > 1 );  /* otherwise the unbiased variance is not defined */
-  for( i = 0 ; i < l ; i++ ) {
-    sum += v[i];
-    var += v[i] * v[i];
-  }
+  sum = blas_sum( v, l );
+  var = blas_sum_sqr( v, l );
 
   return (var - sum * sum / l) / (l - 1 );
 }
@@ -1327,6 +1604,13 @@ double vec_norm( vec v, double n )
   double nr = 0;
   assert( v );
   assert( n > 0 );
+
+  /* |x|^1 is |x| exactly, whatever the mode of the sums */
+  if( n == 1 )
+    return blas_asum( v, Vec_length( v ) );
+  if( n == 2 && blas_mode() == BLAS_BLOCKED )
+    return sqrt( blas_sum_sqr( v, Vec_length( v ) ) );
+
   for( i = 0 ; i < Vec_length( v ) ; i++ )
     nr += pow( fabs( v[ i ] ), n );
 
@@ -426,6 +426,7 @@ vec * it_wavelet_split( vec wav, int nb_levels ) {
   mid = ( nb + 1 ) / 2;
 
   subbands = (vec *) malloc( sizeof( vec ) * ( nb_levels + 1 ) );
+  Vec_alloc_account( sizeof( vec ) * ( nb_levels + 1 ) );
   
   for( l = nb_levels ; l > 0 ; l-- ) {
     subbands[ l ] = vec_get_subvector( wav, mid, nb - 1 );
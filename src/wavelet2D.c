@@ -22,10 +22,16 @@
   Copyright (C) 2005 Vivien Chappelier, Herve Jegou
 */
 
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "../include/types.h"
 #include "../include/wavelet.h"
 #include "../include/wavelet2D.h"
+#include "../include/lifting.h"
+#include "../include/pool.h"
 #include "../include/io.h"
+#include "../include/arena.h"
 
 /* This computes the wavelet decomposition using the lifting implementation.
    It uses a buffer of exactly twice the size of the image. As the memory 
@@ -96,102 +102,934 @@ do {						\
   high_high = buffer + (page >> 1) + 3 * (page >> 2); \
 } while(0)
 
-#define increment_pointers()			\
-do {						\
-  pixels+=2;					\
-  low++;					\
-  high++;					\
-  high_low++;					\
-  high_high++;					\
-  low_high++;					\
-  low_low++;					\
-} while(0)
+#define shift_up(x, l) ((x + ~(-1 << l)) >> l)
+#define round_up(x, l) (shift_up(x, l) << l)
 
-#define adjust_pointers(odd)			\
-do {						\
-  pixels+=odd;					\
-  if(odd == 1) low++;				\
-  if(odd == -1) high--;				\
-} while(0)
+/* neighbour i of a line of n samples, mirrored at both ends. On the lines
+   of 2 or 3 samples of the deep levels, both ends are reached from the
+   same sample; the former lifting macros, which set the first and last
+   samples apart, did not invert there (see tests/test_wavelet2D.c). */
+#define mirror(i, n) ((i) < 0 ? 0 : ((i) >= (n) ? (n) - 1 : (i)))
+
+/* All the lifting steps and the scaling are applied in a single sweep,
+   both along the lines and down the columns. As in line-based coders,
+   step k runs k/2 samples behind the first one, so that the neighbours
+   it needs are ready: the samples in flight stay in the L1 cache while
+   the line (or the band) is read and written once. A sample is computed
+   exactly as by separate passes over the whole image, only earlier.
+   Horizontally, a line is swept by chunks; vertically, a band is swept
+   by strips of columns, row after row. The samples in flight take about
+   STRIP_BYTES. */
+#define STRIP_BYTES (32 * 1024)
+
+/* width of the chunks or strips for count pairs of lifting steps */
+static int __strip_width(int count)
+{
+  int n = STRIP_BYTES / (sizeof(double) * (2 * count + 4));
 
+  n &= ~7; /* whole cache lines */
+  return((n < 8) ? 8 : n);
+}
 
-#define hlifting(dest, source, constant, alt_source_pre, alt_source, alt_source_post, w, h, odd)	\
-do {									\
-  reset_pointers();							\
-  for(y = 0; y < (h); y++) {						\
-    (dest) = (source) + (constant) * (alt_source_pre);			\
-    increment_pointers();						\
-									\
-    for(x = 1; x < (w)-1; x++) {					\
-      (dest) = (source) + (constant) * (alt_source);			\
-      increment_pointers();						\
-    }									\
-    									\
-    (dest) = (source) + (constant) * (alt_source_post);			\
-    increment_pointers();						\
-    adjust_pointers(odd);						\
-  }									\
-} while(0)
+/* Lifting of the samples i0 <= i < i1 of the line d from their
+   neighbours among the na samples of a:
+     d[i] = d[i] + c * (a[i-1+odd] + a[i+odd])
+   odd is 1 when the odd samples are predicted from the even ones (a[i]
+   and a[i+1]), 0 when the even samples are updated from the odd ones
+   (a[i-1] and a[i]). The samples with both neighbours inside a are
+   processed by the vector kernel, the mirrored boundaries here. */
+static void __hlift(double *d, double const *a, int na, int odd, double c,
+		    int i0, int i1)
+{
+  int i, n;
 
-#define hlifting(dest, source, constant, alt_source_pre, alt_source, alt_source_post, w, h, odd)	\
-do {									\
-  reset_pointers();							\
-  for(y = 0; y < (h); y++) {						\
-    (dest) = (source) + (constant) * (alt_source_pre);			\
-    increment_pointers();						\
-									\
-    for(x = 1; x < (w)-1; x++) {					\
-      (dest) = (source) + (constant) * (alt_source);			\
-      increment_pointers();						\
-    }									\
-    									\
-    (dest) = (source) + (constant) * (alt_source_post);			\
-    increment_pointers();						\
-    adjust_pointers(odd);						\
-  }									\
-} while(0)
+  if(!na) return; /* a single sample */
 
-#define vlifting(dest, source, constant, alt_source_pre, alt_source, alt_source_post, line, w, h)	\
-do {									\
-  reset_pointers();							\
-  for(x = 0; x < w; x ++) {						\
-    (dest) = (source) + (constant) * (alt_source_pre);			\
-    increment_pointers();						\
-  }									\
-  (line) += p;								\
-  for(y = 1; y < h-1; y ++) {						\
-    for(x = 0; x < w; x ++) {						\
-      (dest) = (source) + (constant) * (alt_source);			\
-      increment_pointers();						\
-    }									\
-    (line) += p;							\
-  }									\
-  for(x = 0; x < w; x ++) {						\
-    (dest) = (source) + (constant) * (alt_source_post);			\
-    increment_pointers();						\
-  }									\
-} while(0)
+  for(i = i0; i < i1; i++) {
+    if(i >= 1 - odd && i < na - odd) {
+      n = ((i1 < na - odd) ? i1 : na - odd) - i;
+      lifting_step(d + i, d + i, a + i - 1 + odd, a + i + odd, c, n);
+      i += n - 1;
+    } else
+      d[i] = d[i] + c * (a[mirror(i-1+odd, na)] + a[mirror(i+odd, na)]);
+  }
+}
 
-#define scale(dest, scale, count)		\
+/* samples [t - lag, t - lag + n) of a line of length, clipped */
+#define clip_range(i0, i1, t, lag, n, length)	\
 do {						\
-  reset_pointers();				\
-  for(x = 0; x < (count); x++) {		\
-    (dest)[0] *= (scale);			\
-    increment_pointers();			\
-  }						\
+  (i0) = (t) - (lag);				\
+  (i1) = (i0) + (n);				\
+  if((i0) < 0) (i0) = 0;			\
+  if((i1) > (length)) (i1) = (length);		\
 } while(0)
 
-#define shift_up(x, l) ((x + ~(-1 << l)) >> l)
-#define round_up(x, l) (shift_up(x, l) << l)
+/* horizontal decomposition of a line of w samples into its (w+1)/2 low
+   and w/2 high samples */
+static void __hsplit_line(double const *x, double *low, double *high,
+			  int w, double const *step, int count,
+			  double scale)
+{
+  int t, k, i0, i1;
+  int nl = (w + 1) / 2;
+  int nh = w / 2;
+  int chunk = __strip_width(count);
+
+  lifting_split(low, high, x, w);
+
+  for(t = 0; t < nl + count; t += chunk) {
+    for(k = 0; k < 2 * count; k++) {
+      if(!(k & 1)) {
+	/* stage 1 (3) : odd samples lifting */
+	clip_range(i0, i1, t, k / 2, chunk, nh);
+	__hlift(high, low, nl, 1, step[k], i0, i1);
+      } else {
+	/* stage 2 (4) : even samples lifting */
+	clip_range(i0, i1, t, k / 2, chunk, nl);
+	__hlift(low, high, nh, 0, step[k], i0, i1);
+      }
+    }
+
+    /* samples no step needs anymore */
+    clip_range(i0, i1, t, count - 1, chunk, nl);
+    if(i1 > i0) lifting_scale(low + i0, scale, i1 - i0);
+    clip_range(i0, i1, t, count, chunk, nh);
+    if(i1 > i0) lifting_scale(high + i0, 1.0/scale, i1 - i0);
+  }
+}
+
+/* inverse of __hsplit_line: the steps are undone in reverse order, the
+   j-th one (j+1)/2 samples behind */
+static void __hmerge_line(double *x, double *low, double *high,
+			  int w, double const *step, int count,
+			  double scale)
+{
+  int t, j, k, i0, i1;
+  int nl = (w + 1) / 2;
+  int nh = w / 2;
+  int chunk = __strip_width(count);
+
+  for(t = 0; t < nl + count; t += chunk) {
+    clip_range(i0, i1, t, 0, chunk, nl);
+    if(i1 > i0) lifting_scale(low + i0, 1.0/scale, i1 - i0);
+    clip_range(i0, i1, t, 0, chunk, nh);
+    if(i1 > i0) lifting_scale(high + i0, scale, i1 - i0);
+
+    for(j = 0; j < 2 * count; j++) {
+      k = 2 * count - 1 - j;
+      if(!(k & 1)) {
+	/* stage 1 (3) : odd samples lifting */
+	clip_range(i0, i1, t, (j + 1) / 2, chunk, nh);
+	__hlift(high, low, nl, 1, -step[k], i0, i1);
+      } else {
+	/* stage 2 (4) : even samples lifting */
+	clip_range(i0, i1, t, (j + 1) / 2, chunk, nl);
+	__hlift(low, high, nh, 0, -step[k], i0, i1);
+      }
+    }
+  }
+
+  lifting_merge(x, low, high, w);
+}
+
+/* Rows of a band and of its low and high bands: either of stride p from
+   band, vlow and vhigh, or, in place, the lines of an image from column
+   col, the low and high rows being the even and odd lines. Line i is
+   lines[i % ring], so that the lines may be a ring of the last ones. */
+typedef struct _lifting_rows_ {
+  double *band, *vlow, *vhigh;
+  double **lines;
+  int ring;
+  int col, p;
+} lifting_rows_t;
+
+#define line_row(r, i) ((r)->lines[(i) % (r)->ring] + (r)->col)
+#define band_row(r, i) ((r)->lines ? line_row(r, i) : (r)->band + (i) * (r)->p)
+#define low_row(r, i)  ((r)->lines ? line_row(r, 2*(i)) : (r)->vlow + (i) * (r)->p)
+#define high_row(r, i) ((r)->lines ? line_row(r, 2*(i)+1) : (r)->vhigh + (i) * (r)->p)
+
+/* time t of the vertical decomposition of a strip of len columns of a
+   band of h rows into its low (vlow) and high (vhigh) bands.
+   Step k (step[k], on the odd rows if k is even, on the even ones
+   otherwise) is applied to sample i = t - k/2 at time t, which needs
+   the rows of the band up to 2t+2. Row 0 of vhigh is scaled by the
+   caller. */
+static void __vsplit_time(lifting_rows_t const *r, int h,
+			  double const *step, int count,
+			  double scale, int len, int t)
+{
+  int k, i, odd, na;
+  int nl = (h + 1) / 2;
+  int nh = h / 2;
+  double *d, *s, *a0, *a1;
+
+  for(k = 0; k < 2 * count; k++) {
+    i = t - k / 2;
+    odd = !(k & 1);
+    if(i < 0 || i >= (odd ? nh : nl)) continue;
+
+    if(odd) {
+      /* stage 1 (3) : odd samples lifting */
+      na = nl;
+      d = high_row(r, i);
+      s = k ? d : band_row(r, 2*i+1);
+      a0 = k ? low_row(r, mirror(i, na)) : band_row(r, 2*mirror(i, na));
+      a1 = k ? low_row(r, mirror(i+1, na)) : band_row(r, 2*mirror(i+1, na));
+    } else {
+      /* stage 2 (4) : even samples lifting */
+      na = nh;
+      d = low_row(r, i);
+      s = (k > 1) ? d : band_row(r, 2*i);
+      if(!na) {
+	/* a single row, without neighbours */
+	if(d != s) memcpy(d, s, len * sizeof(double));
+	continue;
+      }
+      a0 = high_row(r, mirror(i-1, na));
+      a1 = high_row(r, mirror(i, na));
+    }
+
+    lifting_step(d, s, a0, a1, step[k], len);
+  }
+
+  /* rows no step needs anymore */
+  i = t - (count - 1);
+  if(i >= 0 && i < nl)
+    lifting_scale(low_row(r, i), scale, len);
+  i = t - count;
+  if(i >= 1 && i < nh)
+    lifting_scale(high_row(r, i), 1.0/scale, len);
+}
+
+/* vertical decomposition of a strip of len columns of a band of h rows */
+static void __vsplit_strip(lifting_rows_t const *r, int h,
+			   double const *step, int count,
+			   double scale, int len)
+{
+  int t;
+
+  for(t = 0; t < (h + 1) / 2 + count; t++)
+    __vsplit_time(r, h, step, count, scale, len, t);
+}
+
+/* inverse of __vsplit_strip: the steps are undone in reverse order, the
+   j-th one on sample i = t - (j+1)/2 at time t. Row 0 of vhigh is
+   unscaled by the caller. */
+static void __vmerge_strip(lifting_rows_t const *r, int h,
+			   double const *step, int count,
+			   double scale, int len)
+{
+  int t, j, k, i, odd, na;
+  int nl = (h + 1) / 2;
+  int nh = h / 2;
+  double *d, *s, *a0, *a1;
+
+  for(t = 0; t < nl + count; t++) {
+    if(t < nl)
+      lifting_scale(low_row(r, t), 1.0/scale, len);
+    if(t >= 1 && t < nh)
+      lifting_scale(high_row(r, t), scale, len);
+
+    for(j = 0; j < 2 * count; j++) {
+      k = 2 * count - 1 - j;
+      i = t - (j + 1) / 2;
+      odd = !(k & 1);
+      if(i < 0 || i >= (odd ? nh : nl)) continue;
+
+      if(odd) {
+	/* stage 1 (3) : odd samples lifting */
+	na = nl;
+	s = high_row(r, i);
+	d = k ? s : band_row(r, 2*i+1);
+	a0 = k ? low_row(r, mirror(i, na)) : band_row(r, 2*mirror(i, na));
+	a1 = k ? low_row(r, mirror(i+1, na)) : band_row(r, 2*mirror(i+1, na));
+      } else {
+	/* stage 2 (4) : even samples lifting */
+	na = nh;
+	s = low_row(r, i);
+	d = (k > 1) ? s : band_row(r, 2*i);
+	if(!na) {
+	  /* a single row, without neighbours */
+	  if(d != s) memcpy(d, s, len * sizeof(double));
+	  continue;
+	}
+	a0 = high_row(r, mirror(i-1, na));
+	a1 = high_row(r, mirror(i, na));
+      }
+
+      lifting_step(d, s, a0, a1, -step[k], len);
+    }
+  }
+}
+
+/* A filtering pass of a level is cut into tasks run by the thread pool:
+   groups of lines for the horizontal filtering, strips of columns for
+   the vertical one. The tasks write disjoint samples, so that the
+   coefficients do not depend on the number of threads. Each thread gets
+   about TASKS_PER_THREAD tasks, and the levels of less than
+   PARALLEL_SAMPLES samples, where the threads would cost more than they
+   save, are filtered by the calling thread alone. */
+#define TASKS_PER_THREAD 4
+#define PARALLEL_SAMPLES (64 * 1024)
+
+typedef struct _lifting_pass_ {
+  double *band;                  /* lines, or band to filter vertically */
+  double *low, *high;            /* low and high half bands */
+  int width, height;             /* of band */
+  int size;                      /* lines or columns per task */
+  double const *step;
+  int count;
+  double scale;
+  double **lines;                /* in place: lines of the image, */
+  int col;                       /* and first column of the band */
+  double *scratch;               /* in place: scratch_size per task */
+  int scratch_size;
+} lifting_pass_t;
+
+static void __pass_init(lifting_pass_t *pass, double *band,
+			double *low, double *high, int width, int height,
+			double const *step, int count, double scale)
+{
+  pass->band = band;
+  pass->low = low;
+  pass->high = high;
+  pass->width = width;
+  pass->height = height;
+  pass->step = step;
+  pass->count = count;
+  pass->scale = scale;
+  pass->lines = NULL;
+  pass->col = 0;
+  pass->scratch = NULL;
+  pass->scratch_size = 0;
+}
+
+/* n items cut for the threads, by multiples of unit */
+static int __task_size(int n, int unit)
+{
+  int k = TASKS_PER_THREAD * pool_threads();
+  int size = (n + k - 1) / k;
+
+  if(size < 1) size = 1;
+  return((size + unit - 1) / unit * unit);
+}
+
+static void __tasks_run(int samples, int n_tasks,
+			void (*task)(void *arg, int t), void *arg)
+{
+  int t;
+
+  if(samples < PARALLEL_SAMPLES)
+    for(t = 0; t < n_tasks; t++)
+      task(arg, t);
+  else
+    pool_run(n_tasks, task, arg);
+}
+
+static void __pass_run(lifting_pass_t *pass, int n,
+		       void (*task)(void *arg, int t))
+{
+  __tasks_run(pass->width * pass->height, (n + pass->size - 1) / pass->size,
+	      task, pass);
+}
+
+static void __hsplit_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  int w = pass->width, nl = (w + 1) / 2, nh = w / 2;
+  int y, y1 = (t + 1) * pass->size;
+
+  if(y1 > pass->height) y1 = pass->height;
+
+  for(y = t * pass->size; y < y1; y++)
+    __hsplit_line(pass->band + y * w, pass->low + y * nl, pass->high + y * nh,
+		  w, pass->step, pass->count, pass->scale);
+}
+
+static void __hmerge_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  int w = pass->width, nl = (w + 1) / 2, nh = w / 2;
+  int y, y1 = (t + 1) * pass->size;
+
+  if(y1 > pass->height) y1 = pass->height;
+
+  for(y = t * pass->size; y < y1; y++)
+    __hmerge_line(pass->band + y * w, pass->low + y * nl, pass->high + y * nh,
+		  w, pass->step, pass->count, pass->scale);
+}
+
+/* rows of the strip of columns x of a vertical pass */
+static void __strip_rows(lifting_pass_t const *pass, int x, lifting_rows_t *r)
+{
+  r->band = pass->band + x;
+  r->vlow = pass->low + x;
+  r->vhigh = pass->high + x;
+  r->lines = NULL;
+  r->col = 0;
+  r->p = pass->width;
+}
+
+static void __vsplit_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  int x = t * pass->size;
+  int n = (pass->width - x < pass->size) ? pass->width - x : pass->size;
+  lifting_rows_t r;
+
+  __strip_rows(pass, x, &r);
+  __vsplit_strip(&r, pass->height, pass->step, pass->count, pass->scale, n);
+}
+
+static void __vmerge_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  int x = t * pass->size;
+  int n = (pass->width - x < pass->size) ? pass->width - x : pass->size;
+  lifting_rows_t r;
+
+  __strip_rows(pass, x, &r);
+  __vmerge_strip(&r, pass->height, pass->step, pass->count, pass->scale, n);
+}
+
+/* horizontal decomposition of h lines of w samples into their low and
+   high bands */
+static void __hsplit(double *pixels, double *low, double *high,
+		     int w, int h, double const *step, int count,
+		     double scale)
+{
+  lifting_pass_t pass;
+
+  __pass_init(&pass, pixels, low, high, w, h, step, count, scale);
+  pass.size = __task_size(h, 1);
+  __pass_run(&pass, h, __hsplit_task);
+}
+
+/* inverse of __hsplit */
+static void __hmerge(double *pixels, double *low, double *high,
+		     int w, int h, double const *step, int count,
+		     double scale)
+{
+  lifting_pass_t pass;
+
+  __pass_init(&pass, pixels, low, high, w, h, step, count, scale);
+  pass.size = __task_size(h, 1);
+  __pass_run(&pass, h, __hmerge_task);
+}
+
+/* vertical decomposition of a band of p x h samples (rows of stride p)
+   into its low and high bands */
+static void __vsplit(double *band, double *vlow, double *vhigh,
+		     int p, int h, double const *step, int count,
+		     double scale)
+{
+  lifting_pass_t pass;
+  int nl = (h + 1) / 2;
+  int nh = h / 2;
+
+  __pass_init(&pass, band, vlow, vhigh, p, h, step, count, scale);
+  pass.size = __task_size(p, 8);
+  if(pass.size > __strip_width(count))
+    pass.size = __strip_width(count);
+  __pass_run(&pass, p, __vsplit_task);
+
+  /* The scaling has always run over p*(h+1)/2 samples for both bands,
+     thus also over the samples that follow each of them, which may be
+     the first row of vhigh. The inverse undoes it: it is kept, in the
+     same order, for the coefficients not to change. */
+  lifting_scale(vlow + p * nl, scale, p * (h + 1) / 2 - p * nl);
+  lifting_scale(vhigh, 1.0/scale, p);
+  lifting_scale(vhigh + p * nh, 1.0/scale, p * (h + 1) / 2 - p * nh);
+}
+
+/* inverse of __vsplit */
+static void __vmerge(double *band, double *vlow, double *vhigh,
+		     int p, int h, double const *step, int count,
+		     double scale)
+{
+  lifting_pass_t pass;
+  int nl = (h + 1) / 2;
+  int nh = h / 2;
+
+  /* see __vsplit */
+  lifting_scale(vlow + p * nl, 1.0/scale, p * (h + 1) / 2 - p * nl);
+  lifting_scale(vhigh, scale, p);
+  lifting_scale(vhigh + p * nh, scale, p * (h + 1) / 2 - p * nh);
+
+  __pass_init(&pass, band, vlow, vhigh, p, h, step, count, scale);
+  pass.size = __task_size(p, 8);
+  if(pass.size > __strip_width(count))
+    pass.size = __strip_width(count);
+  __pass_run(&pass, p, __vmerge_task);
+}
+
+/* The in-place transform works on the lines of the image itself, which
+   holds the bands in the flattened layout at the end. A line is split
+   (merged) through a scratch line. The vertical lifting updates the even
+   and odd lines in place, as the low and high rows, which are then
+   moved above each other (back) along the cycles of the permutation. */
+
+/* in-place scratch of at least n samples */
+static double *__wavelet2D_scratch(it_wavelet2D_t *wavelet, int n)
+{
+  if(wavelet->scratch && vec_length(wavelet->scratch) < n) {
+    vec_delete(wavelet->scratch);
+    wavelet->scratch = NULL;
+  }
+  if(!wavelet->scratch) {
+    /* kept by the wavelet from one job to the next */
+    it_arena_t *arena = it_arena_use(NULL);
+    wavelet->scratch = vec_new(n);
+    it_arena_use(arena);
+  }
+
+  return(wavelet->scratch);
+}
+
+/* Moves the bytes from offset of the even lines of a band of h lines
+   above the odd ones, or back if inverse is set. tmp holds the bytes,
+   then h flags. */
+static void __unshuffle(void **lines, size_t offset, size_t bytes, int h,
+			void *tmp, int inverse)
+{
+  int nl = (h + 1) / 2;
+  char *done = (char *) tmp + bytes;
+  int start, cur, src;
+
+  memset(done, 0, h);
+
+  for(start = 0; start < h; start++) {
+    if(done[start]) continue;
+
+    /* line cur receives line src */
+    cur = start;
+    memcpy(tmp, (char *) lines[start] + offset, bytes);
+    for(;;) {
+      done[cur] = 1;
+      if(inverse)
+	src = (cur & 1) ? nl + cur / 2 : cur / 2;
+      else
+	src = (cur < nl) ? 2 * cur : 2 * (cur - nl) + 1;
+      if(src == start) break;
+      memcpy((char *) lines[cur] + offset, (char *) lines[src] + offset, bytes);
+      cur = src;
+    }
+    memcpy((char *) lines[cur] + offset, tmp, bytes);
+  }
+}
+
+static void __hsplit_lines_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  int w = pass->width, nl = (w + 1) / 2, nh = w / 2;
+  int y, y1 = (t + 1) * pass->size;
+  double *low = pass->scratch + t * pass->scratch_size;
+  double *high = low + nl;
+
+  if(y1 > pass->height) y1 = pass->height;
+
+  for(y = t * pass->size; y < y1; y++) {
+    __hsplit_line(pass->lines[y], low, high, w, pass->step, pass->count,
+		  pass->scale);
+    memcpy(pass->lines[y], low, nl * sizeof(double));
+    memcpy(pass->lines[y] + nl, high, nh * sizeof(double));
+  }
+}
+
+static void __hmerge_lines_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  int w = pass->width, nl = (w + 1) / 2, nh = w / 2;
+  int y, y1 = (t + 1) * pass->size;
+  double *low = pass->scratch + t * pass->scratch_size;
+  double *high = low + nl;
+
+  if(y1 > pass->height) y1 = pass->height;
+
+  for(y = t * pass->size; y < y1; y++) {
+    memcpy(low, pass->lines[y], nl * sizeof(double));
+    memcpy(high, pass->lines[y] + nl, nh * sizeof(double));
+    __hmerge_line(pass->lines[y], low, high, w, pass->step, pass->count,
+		  pass->scale);
+  }
+}
+
+static void __vsplit_lines_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  int x = t * pass->size;
+  int n = (pass->width - x < pass->size) ? pass->width - x : pass->size;
+  lifting_rows_t r;
+
+  r.band = r.vlow = r.vhigh = NULL;
+  r.p = 0;
+  r.lines = pass->lines;
+  r.ring = pass->height;
+  r.col = pass->col + x;
+  __vsplit_strip(&r, pass->height, pass->step, pass->count, pass->scale, n);
+  __unshuffle((void **) pass->lines, r.col * sizeof(double),
+	      n * sizeof(double), pass->height,
+	      pass->scratch + t * pass->scratch_size, 0);
+}
+
+static void __vmerge_lines_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  int x = t * pass->size;
+  int n = (pass->width - x < pass->size) ? pass->width - x : pass->size;
+  lifting_rows_t r;
+
+  r.band = r.vlow = r.vhigh = NULL;
+  r.p = 0;
+  r.lines = pass->lines;
+  r.ring = pass->height;
+  r.col = pass->col + x;
+  __unshuffle((void **) pass->lines, r.col * sizeof(double),
+	      n * sizeof(double), pass->height,
+	      pass->scratch + t * pass->scratch_size, 1);
+  __vmerge_strip(&r, pass->height, pass->step, pass->count, pass->scale, n);
+}
+
+/* in-place filtering of the w x h samples of the lines from column col */
+static void __lines_run(it_wavelet2D_t *wavelet, double **lines, int col,
+			int w, int h, int vertical,
+			void (*task)(void *arg, int t))
+{
+  lifting_pass_t pass;
+  int count = wavelet->lifting->count / 2;
+  int n = vertical ? w : h;
+
+  __pass_init(&pass, NULL, NULL, NULL, w, h, wavelet->lifting->step, count,
+	      wavelet->lifting->scale);
+  pass.lines = lines;
+  pass.col = col;
+
+  if(vertical) {
+    pass.size = __task_size(w, 8);
+    if(pass.size > __strip_width(count))
+      pass.size = __strip_width(count);
+    pass.scratch_size = pass.size + (h + sizeof(double) - 1) / sizeof(double);
+  } else {
+    pass.size = __task_size(h, 1);
+    pass.scratch_size = w;
+  }
+
+  pass.scratch = __wavelet2D_scratch(wavelet, (n + pass.size - 1) / pass.size
+				                * pass.scratch_size);
+  __pass_run(&pass, n, task);
+}
+
+/* Single precision: the same in-place filtering on lines of floats. The
+   coefficients are computed with the same steps in the same order, each
+   one rounded to float, so that they only differ from the double ones
+   by the accumulated rounding errors.                                  */
+
+static void __fhlift(float *d, float const *a, int na, int odd, float c,
+		     int i0, int i1)
+{
+  int i, n;
+
+  if(!na) return; /* a single sample */
+
+  for(i = i0; i < i1; i++) {
+    if(i >= 1 - odd && i < na - odd) {
+      n = ((i1 < na - odd) ? i1 : na - odd) - i;
+      lifting_fstep(d + i, d + i, a + i - 1 + odd, a + i + odd, c, n);
+      i += n - 1;
+    } else
+      d[i] = d[i] + c * (a[mirror(i-1+odd, na)] + a[mirror(i+odd, na)]);
+  }
+}
+
+static void __fhsplit_line(float *x, float *low, float *high, int w,
+			   double const *step, int count, double scale)
+{
+  int t, k, i0, i1;
+  int nl = (w + 1) / 2;
+  int nh = w / 2;
+  int chunk = __strip_width(count);
+
+  lifting_fsplit(low, high, x, w);
+
+  for(t = 0; t < nl + count; t += chunk) {
+    for(k = 0; k < 2 * count; k++) {
+      if(!(k & 1)) {
+	clip_range(i0, i1, t, k / 2, chunk, nh);
+	__fhlift(high, low, nl, 1, (float) step[k], i0, i1);
+      } else {
+	clip_range(i0, i1, t, k / 2, chunk, nl);
+	__fhlift(low, high, nh, 0, (float) step[k], i0, i1);
+      }
+    }
+
+    clip_range(i0, i1, t, count - 1, chunk, nl);
+    if(i1 > i0) lifting_fscale(low + i0, (float) scale, i1 - i0);
+    clip_range(i0, i1, t, count, chunk, nh);
+    if(i1 > i0) lifting_fscale(high + i0, (float) (1.0/scale), i1 - i0);
+  }
+
+  memcpy(x, low, nl * sizeof(float));
+  memcpy(x + nl, high, nh * sizeof(float));
+}
+
+static void __fhmerge_line(float *x, float *low, float *high, int w,
+			   double const *step, int count, double scale)
+{
+  int t, j, k, i0, i1;
+  int nl = (w + 1) / 2;
+  int nh = w / 2;
+  int chunk = __strip_width(count);
+
+  memcpy(low, x, nl * sizeof(float));
+  memcpy(high, x + nl, nh * sizeof(float));
+
+  for(t = 0; t < nl + count; t += chunk) {
+    clip_range(i0, i1, t, 0, chunk, nl);
+    if(i1 > i0) lifting_fscale(low + i0, (float) (1.0/scale), i1 - i0);
+    clip_range(i0, i1, t, 0, chunk, nh);
+    if(i1 > i0) lifting_fscale(high + i0, (float) scale, i1 - i0);
+
+    for(j = 0; j < 2 * count; j++) {
+      k = 2 * count - 1 - j;
+      if(!(k & 1)) {
+	clip_range(i0, i1, t, (j + 1) / 2, chunk, nh);
+	__fhlift(high, low, nl, 1, (float) -step[k], i0, i1);
+      } else {
+	clip_range(i0, i1, t, (j + 1) / 2, chunk, nl);
+	__fhlift(low, high, nh, 0, (float) -step[k], i0, i1);
+      }
+    }
+  }
+
+  lifting_fmerge(x, low, high, w);
+}
+
+/* rows i of the low and high bands of a strip from column col, in place */
+#define flow_row(lines, i, col)  ((lines)[2*(i)] + (col))
+#define fhigh_row(lines, i, col) ((lines)[2*(i)+1] + (col))
+
+/* __vsplit_strip on the lines of a band of h rows; row 0 of the high
+   band is scaled by __replay_overruns */
+static void __fvsplit_strip(float **lines, int col, int h,
+			    double const *step, int count,
+			    double scale, int len)
+{
+  int t, k, i;
+  int nl = (h + 1) / 2;
+  int nh = h / 2;
+
+  for(t = 0; t < nl + count; t++) {
+    for(k = 0; k < 2 * count; k++) {
+      i = t - k / 2;
+      if(!(k & 1)) {
+	if(i < 0 || i >= nh) continue;
+	lifting_fstep(fhigh_row(lines, i, col), fhigh_row(lines, i, col),
+		      flow_row(lines, mirror(i, nl), col),
+		      flow_row(lines, mirror(i+1, nl), col),
+		      (float) step[k], len);
+      } else {
+	if(i < 0 || i >= nl || !nh) continue;
+	lifting_fstep(flow_row(lines, i, col), flow_row(lines, i, col),
+		      fhigh_row(lines, mirror(i-1, nh), col),
+		      fhigh_row(lines, mirror(i, nh), col),
+		      (float) step[k], len);
+      }
+    }
+
+    i = t - (count - 1);
+    if(i >= 0 && i < nl)
+      lifting_fscale(flow_row(lines, i, col), (float) scale, len);
+    i = t - count;
+    if(i >= 1 && i < nh)
+      lifting_fscale(fhigh_row(lines, i, col), (float) (1.0/scale), len);
+  }
+}
+
+static void __fvmerge_strip(float **lines, int col, int h,
+			    double const *step, int count,
+			    double scale, int len)
+{
+  int t, j, k, i;
+  int nl = (h + 1) / 2;
+  int nh = h / 2;
+
+  for(t = 0; t < nl + count; t++) {
+    if(t < nl)
+      lifting_fscale(flow_row(lines, t, col), (float) (1.0/scale), len);
+    if(t >= 1 && t < nh)
+      lifting_fscale(fhigh_row(lines, t, col), (float) scale, len);
+
+    for(j = 0; j < 2 * count; j++) {
+      k = 2 * count - 1 - j;
+      i = t - (j + 1) / 2;
+      if(!(k & 1)) {
+	if(i < 0 || i >= nh) continue;
+	lifting_fstep(fhigh_row(lines, i, col), fhigh_row(lines, i, col),
+		      flow_row(lines, mirror(i, nl), col),
+		      flow_row(lines, mirror(i+1, nl), col),
+		      (float) -step[k], len);
+      } else {
+	if(i < 0 || i >= nl || !nh) continue;
+	lifting_fstep(flow_row(lines, i, col), flow_row(lines, i, col),
+		      fhigh_row(lines, mirror(i-1, nh), col),
+		      fhigh_row(lines, mirror(i, nh), col),
+		      (float) -step[k], len);
+      }
+    }
+  }
+}
+
+/* tasks of __lines_run on lines of floats, the scratch holding at least
+   as many floats as it would hold doubles */
+static void __fhsplit_lines_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  float **lines = (float **) pass->lines;
+  float *low = (float *) (pass->scratch + t * pass->scratch_size);
+  int y, y1 = (t + 1) * pass->size;
+
+  if(y1 > pass->height) y1 = pass->height;
+
+  for(y = t * pass->size; y < y1; y++)
+    __fhsplit_line(lines[y], low, low + (pass->width + 1) / 2, pass->width,
+		   pass->step, pass->count, pass->scale);
+}
+
+static void __fhmerge_lines_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  float **lines = (float **) pass->lines;
+  float *low = (float *) (pass->scratch + t * pass->scratch_size);
+  int y, y1 = (t + 1) * pass->size;
+
+  if(y1 > pass->height) y1 = pass->height;
+
+  for(y = t * pass->size; y < y1; y++)
+    __fhmerge_line(lines[y], low, low + (pass->width + 1) / 2, pass->width,
+		   pass->step, pass->count, pass->scale);
+}
+
+static void __fvsplit_lines_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  int x = t * pass->size;
+  int n = (pass->width - x < pass->size) ? pass->width - x : pass->size;
+  int col = pass->col + x;
+
+  __fvsplit_strip((float **) pass->lines, col, pass->height, pass->step,
+		  pass->count, pass->scale, n);
+  __unshuffle((void **) pass->lines, col * sizeof(float),
+	      n * sizeof(float), pass->height,
+	      pass->scratch + t * pass->scratch_size, 0);
+}
+
+static void __fvmerge_lines_task(void *arg, int t)
+{
+  lifting_pass_t *pass = (lifting_pass_t *) arg;
+  int x = t * pass->size;
+  int n = (pass->width - x < pass->size) ? pass->width - x : pass->size;
+  int col = pass->col + x;
+
+  __unshuffle((void **) pass->lines, col * sizeof(float),
+	      n * sizeof(float), pass->height,
+	      pass->scratch + t * pass->scratch_size, 1);
+  __fvmerge_strip((float **) pass->lines, col, pass->height, pass->step,
+		  pass->count, pass->scale, n);
+}
+
+/* scales by c the samples f0 <= f < f1 of a band of bw x bh samples at
+   (x, y) of the image (of floats if single), counted line after line */
+static void __scale_band(void **image, int single, int x, int y,
+			 int bw, int bh, int f0, int f1, double c)
+{
+  int f, n;
+
+  if(f0 < 0) f0 = 0;
+  if(f1 > bw * bh) f1 = bw * bh;
+
+  for(f = f0; f < f1; f += n) {
+    n = bw - f % bw;
+    if(n > f1 - f) n = f1 - f;
+    if(single)
+      lifting_fscale((float *) image[y + f / bw] + x + f % bw, (float) c, n);
+    else
+      lifting_scale((double *) image[y + f / bw] + x + f % bw, c, n);
+  }
+}
+
+/* In the buffer, the scaling of __vsplit also runs over the samples that
+   follow each band (see there), which may start another band: the first
+   row of the vertical high band, the HL band after the LH one, or the LH
+   band of the previous level after the HH one. The same samples are
+   scaled here in the flattened image, for both transforms to give the
+   same coefficients. Each sample is scaled in the same order. */
+
+/* the overrun of a level beyond the first one into the LH band of the
+   previous level, which the other levels do not touch */
+static void __replay_previous(it_wavelet2D_t *wavelet, void **image,
+			      int single, int inverse)
+{
+  it_wavelet2D_level_t const *plan = wavelet->plan + wavelet->level;
+  int h = plan->height;
+  int nh = plan->width / 2, vh = h / 2;
+  int slot = plan->page >> 2;
+  double scale = wavelet->lifting->scale;
+  double down = inverse ? scale : 1.0/scale;
+
+  if(!wavelet->level) return;
+
+  __scale_band(image, single, 0, plan->height, plan->width,
+	       plan[-1].height / 2, nh * vh - slot, nh * (h + 1) / 2 - slot, down);
+}
+
+static void __replay_overruns(it_wavelet2D_t *wavelet, void **image,
+			      int single, int inverse)
+{
+  it_wavelet2D_level_t const *plan = wavelet->plan + wavelet->level;
+  int w = plan->width, h = plan->height;
+  int nl = (w + 1) / 2, nh = w / 2;
+  int vl = (h + 1) / 2, vh = h / 2;
+  int slot = plan->page >> 2;
+  double scale = wavelet->lifting->scale;
+  double up = inverse ? 1.0/scale : scale;
+  double down = inverse ? scale : 1.0/scale;
+
+  /* vertical split of the high band, into HL and HH */
+  __scale_band(image, single, nl, vl, nh, vh, nh * vl - slot, nh * (h + 1) / 2 - slot, up);
+  __scale_band(image, single, nl, vl, nh, vh, 0, nh, down);
+  __replay_previous(wavelet, image, single, inverse);
+
+  /* vertical split of the low band, into LL and LH */
+  __scale_band(image, single, 0, vl, nl, vh, nl * vl - slot, nl * (h + 1) / 2 - slot, up);
+  __scale_band(image, single, 0, vl, nl, vh, 0, nl, down);
+  __scale_band(image, single, nl, 0, nh, vl, nl * vh - slot, nl * (h + 1) / 2 - slot, down);
+}
+
+/* geometry of the levels of the transform of a width x height image,
+   which only depends on its size */
+static it_wavelet2D_level_t *__plan_new(int levels, int width, int height)
+{
+  it_wavelet2D_level_t *plan;
+  int level;
+
+  plan = (it_wavelet2D_level_t *) malloc((levels + 1) * sizeof(it_wavelet2D_level_t));
+  it_assert( plan != NULL, "No enough memory to allocate the plan" );
+  Vec_alloc_account((levels + 1) * sizeof(it_wavelet2D_level_t));
+
+  for(level = 0; level <= levels; level++) {
+    plan[level].width = shift_up(width, level);
+    plan[level].height = shift_up(height, level);
+    plan[level].page = (round_up(width, levels) * round_up(height, levels)) >> level;
+  }
+
+  return(plan);
+}
 
 /* compute the next level decomposition using the lifting method. */
 static int __wavelet2D_split(it_wavelet2D_t *wavelet)
 {
-  int i, x, y, w, h, p;
-  int width;
-  int height;
-  int level;
-  int levels;
+  int w, h, nl, nh;
+  it_wavelet2D_level_t const *plan;
   double *buffer;
   double *pixels;
   double *low, *high, *low_high, *low_low, *high_low, *high_high;
@@ -204,611 +1042,530 @@ static int __wavelet2D_split(it_wavelet2D_t *wavelet)
 
   if(wavelet->level == wavelet->levels) return(-IT_EINVAL);
 
-  width = wavelet->width;
-  height = wavelet->height;
-  level = wavelet->level;
-  levels = wavelet->levels;
+  plan = wavelet->plan + wavelet->level;
   buffer = wavelet->buffer;
   count = wavelet->lifting->count / 2;
   step = wavelet->lifting->step;
   scale = wavelet->lifting->scale;
 
-  w = shift_up(width, level);
-  h = shift_up(height, level);
-  page = (round_up(width, levels) * round_up(height, levels)) >> level;
+  w = plan->width;
+  h = plan->height;
+  page = plan->page;
+  nl = (w + 1) / 2;
+  nh = w / 2;
+
+  reset_pointers();
 
   /* horizontal filtering */
+  __hsplit(pixels, low, high, w, h, step, count, scale);
 
-  /* stage 1 : odd samples lifting */
-  if(w & 1) {
-    hlifting(high[0], pixels[1], step[0],
-	     pixels[0] + pixels[2],
-	     pixels[0] + pixels[2],
-	     pixels[0] + pixels[2],
-	     w/2, h, 1);
-  } else {
-    hlifting(high[0], pixels[1], step[0],
-	     pixels[0] + pixels[2],
-	     pixels[0] + pixels[2],
-	     pixels[0] + pixels[0],
-	     w/2, h, 0);
-  }
-    
-  /* stage 2 : even samples lifting */
-  if(w & 1) {
-    hlifting(low[0], pixels[0], step[1],
-	     high[0] + high[0],
-	     high[-1] + high[0],
-	     high[-1] + high[-1],
-	     w/2 + 1, h, -1);
-  } else {
-    hlifting(low[0], pixels[0], step[1],
-	     high[0] + high[0],
-	     high[-1] + high[0],
-	     high[-1] + high[0],
-	     w/2, h, 0);
-  }
-    
-  reset_pointers();
+  /* vertical filtering (on horizontal high band) */
+  __vsplit(high, high_low, high_high, nh, h, step, count, scale);
 
-  for(i = 1; i < count; i++) {
-    /* stage 3 : odd samples lifting */
-    if(w & 1) {
-      hlifting(high[0], high[0], step[2*i],
-	       low[0] + low[1],
-	       low[0] + low[1],
-	       low[0] + low[1],
-	       w/2, h, 1);
-    } else {
-      hlifting(high[0], high[0], step[2*i],
-	       low[0] + low[1],
-	       low[0] + low[1],
-	       low[0] + low[0],
-	       w/2, h, 0);
-    }
+  /* vertical filtering (on horizontal low band) */
+  __vsplit(low, low_low, low_high, nl, h, step, count, scale);
+
+  wavelet->level++;
   
-    /* stage 4 : even samples lifting */
-    if(w & 1) {
-      hlifting(low[0], low[0], step[2*i+1],
-	       high[0] + high[0],
-	       high[-1] + high[0],
-	       high[-1] + high[-1],
-	       w/2 + 1, h, -1);
-    } else {
-      hlifting(low[0], low[0], step[2*i+1],
-	       high[0] + high[0],
-	       high[-1] + high[0],
-	       high[-1] + high[0],
-	       w/2, h, 0);
-    }
-  }
+  return(0);
+}
+
+/* reconstruct the previous level of decomposition
+   by inverting the lifting steps. */
+static int __wavelet2D_merge(it_wavelet2D_t *wavelet)
+{
+  int w, h, nl, nh;
+  it_wavelet2D_level_t const *plan;
+  double *pixels;
+  double *buffer;
+  double *low, *high, *low_high, *low_low, *high_low, *high_high;
+  int page;
+  int count;
+  double const *step;
+  double scale;
+  
+  assert(wavelet);
+
+  if(wavelet->level == 0) return(-IT_EINVAL);
 
-  scale(low, scale, ((w+1)/2)*h);
-  scale(high, 1.0/scale, (w/2)*h);
+  wavelet->level--;
+
+  plan = wavelet->plan + wavelet->level;
+  buffer = wavelet->buffer;
+  count = wavelet->lifting->count / 2;
+  step = wavelet->lifting->step;
+  scale = wavelet->lifting->scale;
+
+  w = plan->width;
+  h = plan->height;
+  page = plan->page;
+  nl = (w + 1) / 2;
+  nh = w / 2;
+
+  reset_pointers();
+
+  /* vertical filtering (on horizontal low band) */
+  __vmerge(low, low_low, low_high, nl, h, step, count, scale);
 
   /* vertical filtering (on horizontal high band) */
-  p = w / 2;
-  /* stage 1 : odd samples lifting */
-  if(h & 1) {
-    vlifting(high_high[0], high[p], step[0],
-	     high[0] + high[2*p],
-	     high[0] + high[2*p],
-	     high[0] + high[2*p],
-	     high,
-	     w/2, h/2);
-  } else {
-    vlifting(high_high[0], high[p], step[0],
-	     high[0] + high[2*p],
-	     high[0] + high[2*p],
-	     high[0] + high[0],
-	     high,
-	     w/2, h/2);
+  __vmerge(high, high_low, high_high, nh, h, step, count, scale);
+
+  /* horizontal filtering */
+  __hmerge(pixels, low, high, w, h, step, count, scale);
+
+  return(0);
+}
+
+/* compute the next level decomposition in place, on lines of floats if
+   single is set */
+static int __wavelet2D_split_lines(it_wavelet2D_t *wavelet, void **image,
+				   int single)
+{
+  it_wavelet2D_level_t const *plan;
+  int w, h, nl, nh;
+
+  if(wavelet->level == wavelet->levels) return(-IT_EINVAL);
+
+  plan = wavelet->plan + wavelet->level;
+  w = plan->width;
+  h = plan->height;
+  nl = (w + 1) / 2;
+  nh = w / 2;
+
+  __lines_run(wavelet, (double **) image, 0, w, h, 0,
+	      single ? __fhsplit_lines_task : __hsplit_lines_task);
+  __lines_run(wavelet, (double **) image, nl, nh, h, 1,
+	      single ? __fvsplit_lines_task : __vsplit_lines_task);
+  __lines_run(wavelet, (double **) image, 0, nl, h, 1,
+	      single ? __fvsplit_lines_task : __vsplit_lines_task);
+  __replay_overruns(wavelet, image, single, 0);
+
+  wavelet->level++;
+
+  return(0);
+}
+
+/* reconstruct the previous level of decomposition in place */
+static int __wavelet2D_merge_lines(it_wavelet2D_t *wavelet, void **image,
+				   int single)
+{
+  it_wavelet2D_level_t const *plan;
+  int w, h, nl, nh;
+
+  if(wavelet->level == 0) return(-IT_EINVAL);
+
+  wavelet->level--;
+
+  plan = wavelet->plan + wavelet->level;
+  w = plan->width;
+  h = plan->height;
+  nl = (w + 1) / 2;
+  nh = w / 2;
+
+  __replay_overruns(wavelet, image, single, 1);
+  __lines_run(wavelet, (double **) image, 0, nl, h, 1,
+	      single ? __fvmerge_lines_task : __vmerge_lines_task);
+  __lines_run(wavelet, (double **) image, nl, nh, h, 1,
+	      single ? __fvmerge_lines_task : __vmerge_lines_task);
+  __lines_run(wavelet, (double **) image, 0, w, h, 0,
+	      single ? __fhmerge_lines_task : __hmerge_lines_task);
+
+  return(0);
+}
+
+/* copy a band of h lines of w coefficients to/from the image at (x, y) */
+#define band_to_image(band, image, x, y, w, h)				\
+do {									\
+  int __j;								\
+  for(__j = 0; __j < (h); __j++)					\
+    memcpy((image)[(y) + __j] + (x), (band) + __j * (w), (w) * sizeof(double)); \
+} while(0)
+
+#define image_to_band(band, image, x, y, w, h)				\
+do {									\
+  int __j;								\
+  for(__j = 0; __j < (h); __j++)					\
+    memcpy((band) + __j * (w), (image)[(y) + __j] + (x), (w) * sizeof(double)); \
+} while(0)
+
+/* arrange the transformed coefficients in an image */
+/* where the top left corner contains the lowest band.  */
+static int __wavelet_flatten(it_wavelet2D_t *it_this, mat image)
+{
+  int wf, hf, wc, hc;
+  int level, page;
+  int levels;
+  double *buffer = it_this->buffer;
+
+  levels = it_this->levels;
+
+  if(it_this->width != mat_width(image)) return(-IT_EINVAL);
+  if(it_this->height != mat_height(image)) return(-IT_EINVAL);
+
+  for(level = 0; level < levels; level++) {
+    page = it_this->plan[level].page;
+    buffer = (it_this->buffer) + (page >> 1);
+
+    hf = it_this->plan[level].height / 2;
+    hc = it_this->plan[level + 1].height;
+    wf = it_this->plan[level].width / 2;
+    wc = it_this->plan[level + 1].width;
+
+    band_to_image(buffer + 2*(page >> 2), image, wc, 0, wf, hc);   /* HL */
+    band_to_image(buffer + 1*(page >> 2), image, 0, hc, wc, hf);   /* LH */
+    band_to_image(buffer + 3*(page >> 2), image, wc, hc, wf, hf);  /* HH */
   }
 
-  /* stage 2 : even samples lifting */
-  if(h & 1) {
-    vlifting(high_low[0], high[0], step[1],
-	     high_high[0] + high_high[0],
-	     high_high[-p] + high_high[0],
-	     high_high[-p] + high_high[-p],
-	     high,
-	     w/2 , h/2 + 1);
-  } else {
-    vlifting(high_low[0], high[0], step[1],
-	     high_high[0] + high_high[0],
-	     high_high[-p] + high_high[0],
-	     high_high[-p] + high_high[0],
-	     high,
-	     w/2, h/2);
+  /* LL */
+  band_to_image(buffer, image, 0, 0,
+		it_this->plan[levels].width, it_this->plan[levels].height);
+
+  return(0);
+}
+
+/* read the transformed coefficients from an image */
+/* where the top left corner contains the lowest band.  */
+static int __wavelet_unflatten(it_wavelet2D_t *it_this, mat image)
+{
+  int wf, hf, wc, hc;
+  int level, page;
+  int levels;
+  double *buffer = it_this->buffer;
+
+  levels = it_this->levels;
+
+  if(it_this->width != mat_width(image)) return(-IT_EINVAL);
+  if(it_this->height != mat_height(image)) return(-IT_EINVAL);
+
+  /* we are given a fully decomposed image */
+  it_this->level = levels;
+
+  for(level = 0; level < levels; level++) {
+    page = it_this->plan[level].page;
+    buffer = (it_this->buffer) + (page >> 1);
+
+    hf = it_this->plan[level].height / 2;
+    hc = it_this->plan[level + 1].height;
+    wf = it_this->plan[level].width / 2;
+    wc = it_this->plan[level + 1].width;
+
+    image_to_band(buffer + 2*(page >> 2), image, wc, 0, wf, hc);   /* HL */
+    image_to_band(buffer + 1*(page >> 2), image, 0, hc, wc, hf);   /* LH */
+    image_to_band(buffer + 3*(page >> 2), image, wc, hc, wf, hf);  /* HH */
   }
 
-  for(i = 1; i < count; i++) {
-    /* stage 3 : odd samples lifting */
-    if(h & 1) {
-      vlifting(high_high[0], high_high[0], step[2*i],
-	       high_low[0] + high_low[p],
-	       high_low[0] + high_low[p],
-	       high_low[0] + high_low[p],
-	       high,
-	       w/2, h/2);
-    } else {
-      vlifting(high_high[0], high_high[0], step[2*i],
-	       high_low[0] + high_low[p],
-	       high_low[0] + high_low[p],
-	       high_low[0] + high_low[0],
-	       high,
-	       w/2, h/2);
+  /* LL */
+  image_to_band(buffer, image, 0, 0,
+		it_this->plan[levels].width, it_this->plan[levels].height);
+
+  return(0);
+}
+
+/* buffer of the transform, allocated on first use */
+static double *__wavelet2D_buffer(it_wavelet2D_t *wavelet)
+{
+  int levels = wavelet->levels;
+
+  if(!wavelet->buffer) {
+    it_arena_t *arena = it_arena_use(NULL);
+    wavelet->buffer = vec_new(2 * round_up(wavelet->width, levels) * round_up(wavelet->height, levels));
+    it_arena_use(arena);
+  }
+
+  return(wavelet->buffer);
+}
+
+/* check the image is of the size set beforehand */
+static int __wavelet2D_check(it_wavelet2D_t *wavelet, mat image)
+{
+  assert(image);
+
+  if(!wavelet->width || !wavelet->height) return(-IT_EINVAL);
+  if(wavelet->width != mat_width(image)) return(-IT_EINVAL);
+  if(wavelet->height != mat_height(image)) return(-IT_EINVAL);
+
+  return(0);
+}
+
+/* compute the wavelet transform of the image in the buffer, */
+/* where each band is stored contiguously.                   */
+int it_wavelet2D_transform_packed(it_wavelet2D_t *wavelet, mat image)
+{
+  if(__wavelet2D_check(wavelet, image)) return(-IT_EINVAL);
+
+  wavelet->level = 0;
+
+  image_to_band(__wavelet2D_buffer(wavelet) + wavelet->plan[0].page, image, 0, 0,
+		wavelet->width, wavelet->height);
+
+  while(wavelet->level < wavelet->levels)
+    __wavelet2D_split(wavelet);
+
+  return(0);
+}
+
+/* compute the inverse wavelet transform of the bands in the buffer */
+int it_wavelet2D_itransform_packed(it_wavelet2D_t *wavelet, mat image)
+{
+  if(__wavelet2D_check(wavelet, image)) return(-IT_EINVAL);
+
+  __wavelet2D_buffer(wavelet);
+  wavelet->level = wavelet->levels;
+
+  while(wavelet->level)
+    __wavelet2D_merge(wavelet);
+
+  band_to_image(wavelet->buffer + wavelet->plan[0].page, image, 0, 0,
+		wavelet->width, wavelet->height);
+
+  return(0);
+}
+
+/* band of a level in the buffer */
+double *it_wavelet2D_band(it_wavelet2D_t *wavelet, int level, int band,
+			  int *width, int *height)
+{
+  it_wavelet2D_level_t const *plan;
+  double *buffer;
+  int page;
+
+  assert(level >= 0 && level < wavelet->levels);
+  assert(band != IT_WAVELET2D_LL || level == wavelet->levels - 1);
+
+  plan = wavelet->plan + level;
+  page = plan->page;
+  buffer = __wavelet2D_buffer(wavelet) + (page >> 1);
+
+  /* the high bands are half (rounded down) of the level in their
+     direction of high-pass filtering, the low ones the other half */
+  *width = (band & IT_WAVELET2D_HL) ? plan[0].width / 2 : plan[1].width;
+  *height = (band & IT_WAVELET2D_LH) ? plan[0].height / 2 : plan[1].height;
+
+  switch(band) {
+  case IT_WAVELET2D_HL: return(buffer + 2*(page >> 2));
+  case IT_WAVELET2D_LH: return(buffer + 1*(page >> 2));
+  case IT_WAVELET2D_HH: return(buffer + 3*(page >> 2));
+  default: return(buffer);
+  }
+}
+
+/* compute the wavelet transform of the image in the matrix flat, */
+/* both being of the size set beforehand.                        */
+int it_wavelet2D_transform_into(it_wavelet2D_t *wavelet, mat image, mat flat)
+{
+  if(it_wavelet2D_transform_packed(wavelet, image)) return(-IT_EINVAL);
+
+  return(__wavelet_flatten(wavelet, flat));
+}
+
+/* compute the inverse wavelet transform of the coefficients in the */
+/* matrix image, both being of the size set beforehand.            */
+int it_wavelet2D_itransform_into(it_wavelet2D_t *wavelet, mat flat, mat image)
+{
+  if(__wavelet2D_check(wavelet, image)) return(-IT_EINVAL);
+
+  __wavelet2D_buffer(wavelet);
+  if(__wavelet_unflatten(wavelet, flat)) return(-IT_EINVAL);
+
+  return(it_wavelet2D_itransform_packed(wavelet, image));
+}
+
+/* The lines of doubles are turned into lines of floats in their first
+   half and back, for the single precision to filter a matrix in place.
+   The samples are moved with memcpy, the memory being read with both
+   types. */
+static void __lines_to_float(mat image, int w, int h)
+{
+  float f;
+  int x, y;
+
+  for(y = 0; y < h; y++)
+    for(x = 0; x < w; x++) {
+      f = (float) image[y][x];
+      memcpy((float *) image[y] + x, &f, sizeof(float));
     }
-    
-    /* stage 4 : even samples lifting */
-    if(h & 1) {
-      vlifting(high_low[0], high_low[0], step[2*i+1],
-	       high_high[0] + high_high[0],
-	       high_high[-p] + high_high[0],
-	       high_high[-p] + high_high[-p],
-	       high,
-	       w/2, h/2+1);
-    } else {
-      vlifting(high_low[0], high_low[0], step[2*i+1],
-	       high_high[0] + high_high[0],
-	       high_high[-p] + high_high[0],
-	       high_high[-p] + high_high[0],
-	       high,
-	       w/2, h/2);
+}
+
+static void __lines_to_double(mat image, int w, int h)
+{
+  float f;
+  int x, y;
+
+  for(y = 0; y < h; y++)
+    for(x = w - 1; x >= 0; x--) {
+      memcpy(&f, (float *) image[y] + x, sizeof(float));
+      image[y][x] = f;
     }
-  }
-  scale(high_low, scale, p*(h+1)/2);
-  scale(high_high, 1.0/scale, p*(h+1)/2);
+}
 
-  /* vertical filtering (on horizontal low band) */
-  p = (w + 1) / 2;
-  /* stage 1 : odd samples lifting */
-  if(h & 1) {
-    vlifting(low_high[0], low[p], step[0],
-	     low[0] + low[2*p],
-	     low[0] + low[2*p],
-	     low[0] + low[2*p],
-	     low,
-	     (w+1)/2, h/2);
-  } else {
-    vlifting(low_high[0], low[p], step[0],
-	     low[0] + low[2*p],
-	     low[0] + low[2*p],
-	     low[0] + low[0],
-	     low,
-	     (w+1)/2, h/2);
-  }
+/* compute the wavelet transform of the image in place */
+int it_wavelet2D_transform_inplace(it_wavelet2D_t *wavelet, mat image)
+{
+  int single = (wavelet->precision == IT_WAVELET2D_F32);
 
-  /* stage 2 : even samples lifting */
-  if(h & 1) {
-    vlifting(low_low[0], low[0], step[1],
-	     low_high[0] + low_high[0],
-	     low_high[-p] + low_high[0],
-	     low_high[-p] + low_high[-p],
-	     low,
-	     (w+1)/2, h/2+1);
-  } else {
-    vlifting(low_low[0], low[0], step[1],
-	     low_high[0] + low_high[0],
-	     low_high[-p] + low_high[0],
-	     low_high[-p] + low_high[0],
-	     low,
-	     (w+1)/2, h/2);
-  }
+  if(__wavelet2D_check(wavelet, image)) return(-IT_EINVAL);
 
-  for(i = 1; i < count; i++) {
-    /* stage 3 : odd samples lifting */
-    if(h & 1) {
-      vlifting(low_high[0], low_high[0], step[2*i],
-	       low_low[0] + low_low[p],
-	       low_low[0] + low_low[p],
-	       low_low[0] + low_low[p],
-	       low,
-	       (w+1)/2, h/2);
-    } else {
-      vlifting(low_high[0], low_high[0], step[2*i],
-	       low_low[0] + low_low[p],
-	       low_low[0] + low_low[p],
-	       low_low[0] + low_low[0],
-	       low,
-	       (w+1)/2, h/2);
-    }
+  if(single) __lines_to_float(image, wavelet->width, wavelet->height);
 
-    /* stage 4 : even samples lifting */
-    if(h & 1) {
-      vlifting(low_low[0], low_low[0], step[2*i+1],
-	       low_high[0] + low_high[0],
-	       low_high[-p] + low_high[0],
-	       low_high[-p] + low_high[-p],
-	       low,
-	       (w+1)/2, h/2 + 1);
-    } else {
-      vlifting(low_low[0], low_low[0], step[2*i+1],
-	       low_high[0] + low_high[0],
-	       low_high[-p] + low_high[0],
-	       low_high[-p] + low_high[0],
-	       low,
-	       (w+1)/2, h/2);
-    }
-  }
-    
-  scale(low_low, scale, p*(h+1)/2);
-  scale(low_high, 1.0/scale, p*(h+1)/2);
+  wavelet->level = 0;
+
+  while(wavelet->level < wavelet->levels)
+    __wavelet2D_split_lines(wavelet, (void **) image, single);
+
+  if(single) __lines_to_double(image, wavelet->width, wavelet->height);
 
-  wavelet->level++;
-  
   return(0);
 }
 
-/* reconstruct the previous level of decomposition
-   by inverting the lifting steps. */
-static int __wavelet2D_merge(it_wavelet2D_t *wavelet)
+/* compute the inverse wavelet transform of the coefficients in place */
+int it_wavelet2D_itransform_inplace(it_wavelet2D_t *wavelet, mat image)
 {
-  int i, x, y, w, h, p;
-  int width;
-  int height;
-  int level;
-  int levels;
-  double *pixels;
-  double *buffer;
-  double *low, *high, *low_high, *low_low, *high_low, *high_high;
-  int page;
-  int count;
-  double const *step;
-  double scale;
-  
-  assert(wavelet);
+  int single = (wavelet->precision == IT_WAVELET2D_F32);
 
-  if(wavelet->level == 0) return(-IT_EINVAL);
+  if(__wavelet2D_check(wavelet, image)) return(-IT_EINVAL);
 
-  wavelet->level--;
+  if(single) __lines_to_float(image, wavelet->width, wavelet->height);
 
-  width = wavelet->width;
-  height = wavelet->height;
-  level = wavelet->level;
-  levels = wavelet->levels;
-  buffer = wavelet->buffer;
-  count = wavelet->lifting->count / 2;
-  step = wavelet->lifting->step;
-  scale = wavelet->lifting->scale;
+  wavelet->level = wavelet->levels;
 
-  w = shift_up(width, level);
-  h = shift_up(height, level);
-  page = (round_up(width, levels) * round_up(height, levels)) >> level;
+  while(wavelet->level)
+    __wavelet2D_merge_lines(wavelet, (void **) image, single);
 
-  /* vertical filtering (on horizontal low band) */
-  p = (w + 1) / 2;
-
-  scale(low_low, 1.0/scale, p*(h+1)/2);
-  scale(low_high, scale, p*(h+1)/2);
-
-  for(i = 1; i < count; i++) {  
-    /* stage 4 : even samples lifting */
-    if(h & 1) {
-      vlifting(low_low[0], low_low[0], -step[2*i+1],
-	       low_high[0] + low_high[0],
-	       low_high[-p] + low_high[0],
-	       low_high[-p] + low_high[-p],
-	       low,
-	       (w+1)/2, h/2+1);
-    } else {
-      vlifting(low_low[0], low_low[0], -step[2*i+1],
-	       low_high[0] + low_high[0],
-	       low_high[-p] + low_high[0],
-	       low_high[-p] + low_high[0],
-	       low,
-	       (w+1)/2, h/2);
-    }
-    
-    /* stage 3 : odd samples lifting */
-    if(h & 1) {
-      vlifting(low_high[0], low_high[0], -step[2*i],
-	       low_low[0] + low_low[p],
-	       low_low[0] + low_low[p],
-	       low_low[0] + low_low[p],
-	       low,
-	       (w+1)/2, h/2);
-    } else {
-      vlifting(low_high[0], low_high[0], -step[2*i],
-	       low_low[0] + low_low[p],
-	       low_low[0] + low_low[p],
-	       low_low[0] + low_low[0],
-	       low,
-	       (w+1)/2, h/2);
-    }
-  }
+  if(single) __lines_to_double(image, wavelet->width, wavelet->height);
 
-  /* stage 2 : even samples lifting */
-  if(h & 1) {
-    vlifting(low[0], low_low[0], -step[1],
-	     low_high[0] + low_high[0],
-	     low_high[-p] + low_high[0],
-	     low_high[-p] + low_high[-p],
-	     low,
-	     (w+1)/2, h/2+1);
-  } else {
-    vlifting(low[0], low_low[0], -step[1],
-	     low_high[0] + low_high[0],
-	     low_high[-p] + low_high[0],
-	     low_high[-p] + low_high[0],
-	     low,
-	     (w+1)/2, h/2);
-  }
-    
-  /* stage 1 : odd samples lifting */
-  if(h & 1) {
-    vlifting(low[p], low_high[0], -step[0],
-	     low[0] + low[2*p],
-	     low[0] + low[2*p],
-	     low[0] + low[2*p],
-	     low,
-	     (w+1)/2, h/2);
-  } else {
-    vlifting(low[p], low_high[0], -step[0],
-	     low[0] + low[2*p],
-	     low[0] + low[2*p],
-	     low[0] + low[0],
-	     low,
-	     (w+1)/2, h/2);
-  }
+  return(0);
+}
 
-  /* vertical filtering (on horizontal high band) */
-  p = w / 2;
-
-  scale(high_low, 1.0/scale, p*(h+1)/2);
-  scale(high_high, scale, p*(h+1)/2);
-
-  for(i = 1; i < count; i++) {      
-    /* stage 4 : even samples lifting */
-    if(h & 1) {
-      vlifting(high_low[0], high_low[0], -step[2*i+1],
-	       high_high[0] + high_high[0],
-	       high_high[-p] + high_high[0],
-	       high_high[-p] + high_high[-p],
-	       high,
-	       w/2, h/2 + 1);
-    } else {
-      vlifting(high_low[0], high_low[0], -step[2*i+1],
-	       high_high[0] + high_high[0],
-	       high_high[-p] + high_high[0],
-	       high_high[-p] + high_high[0],
-	       high,
-	       w/2, h/2);
-    }
+/* compute only the bands of the wavelet transform of the image needed */
+int it_wavelet2D_transform_partial(it_wavelet2D_t *wavelet, mat image,
+				   int bands)
+{
+  int single = (wavelet->precision == IT_WAVELET2D_F32);
+  it_wavelet2D_level_t const *plan = wavelet->plan;
 
-    /* stage 3 : odd samples lifting */
-    if(h & 1) {
-      vlifting(high_high[0], high_high[0], -step[2*i],
-	       high_low[0] + high_low[p],
-	       high_low[0] + high_low[p],
-	       high_low[0] + high_low[p],
-	       high,
-	       w/2, h/2);
-    } else {
-      vlifting(high_high[0], high_high[0], -step[2*i],
-	       high_low[0] + high_low[p],
-	       high_low[0] + high_low[p],
-	       high_low[0] + high_low[0],
-	       high,
-	       w/2, h/2);
-    }
-  }
-  
-  /* stage 2 : even samples lifting */
-  if(h & 1) {
-    vlifting(high[0], high_low[0], -step[1],
-	     high_high[0] + high_high[0],
-	     high_high[-p] + high_high[0],
-	     high_high[-p] + high_high[-p],
-	     high,
-	     w/2, h/2+1);
-  } else {
-    vlifting(high[0], high_low[0], -step[1],
-	     high_high[0] + high_high[0],
-	     high_high[-p] + high_high[0],
-	     high_high[-p] + high_high[0],
-	     high,
-	     w/2, h/2);
-  }
+  if((bands & IT_WAVELET2D_FINEST) && (bands & IT_WAVELET2D_COARSE))
+    return(it_wavelet2D_transform_inplace(wavelet, image));
+  if(__wavelet2D_check(wavelet, image)) return(-IT_EINVAL);
+  if(!bands || !wavelet->levels) return(0);
 
-  /* stage 1 : odd samples lifting */
-  if(h & 1) {
-    vlifting(high[p], high_high[0], -step[0],
-	     high[0] + high[2*p],
-	     high[0] + high[2*p],
-	     high[0] + high[2*p],
-	     high,
-	     w/2, h/2);
-  } else {
-    vlifting(high[p], high_high[0], -step[0],
-	     high[0] + high[2*p],
-	     high[0] + high[2*p],
-	     high[0] + high[0],
-	     high,
-	     w/2, h/2);
-  }
+  if(single) __lines_to_float(image, wavelet->width, wavelet->height);
 
-  /* horizontal filtering */
-  scale(low, 1.0/scale, ((w+1)/2)*h);
-  scale(high, scale, (w/2)*h);
-    
-  for(i = 1; i < count; i++) {
-    /* stage 4 : even samples lifting */
-    if(w & 1) {
-      hlifting(low[0], low[0], -step[2*i+1],
-	       high[0] + high[0],
-	       high[-1] + high[0],
-	       high[-1] + high[-1],
-	       w/2 + 1, h, -1);
-    } else {
-      hlifting(low[0], low[0], -step[2*i+1],
-	       high[0] + high[0],
-	       high[-1] + high[0],
-	       high[-1] + high[0],
-	       w/2, h, 0);
-    }
-  
-    /* stage 3 : odd samples lifting */
-    if(w & 1) {
-      hlifting(high[0], high[0], -step[2*i],
-	       low[0] + low[1],
-	       low[0] + low[1],
-	       low[0] + low[1],
-	       w/2, h, 1);
-    } else {
-      hlifting(high[0], high[0], -step[2*i],
-	       low[0] + low[1],
-	       low[0] + low[1],
-	       low[0] + low[0],
-	       w/2, h, 0);
-    }
-  }
-  
-  /* stage 2 : even samples lifting */
-  if(w & 1) {
-    hlifting(pixels[0], low[0], -step[1],
-	     high[0] + high[0],
-	     high[-1] + high[0],
-	     high[-1] + high[-1],
-	     w/2 + 1, h, -1);
-  } else {
-    hlifting(pixels[0], low[0], -step[1],
-	     high[0] + high[0],
-	     high[-1] + high[0],
-	     high[-1] + high[0],
-	     w/2, h, 0);
-  }
-  
-  /* stage 1 : odd samples lifting */
-  if(w & 1) {
-    hlifting(pixels[1], high[0], -step[0],
-	     pixels[0] + pixels[2],
-	     pixels[0] + pixels[2],
-	     pixels[0] + pixels[2],
-	     w/2, h, 1);
+  wavelet->level = 0;
+
+  if(bands & IT_WAVELET2D_FINEST) {
+    /* the first level, and what the second one scales in it (nothing
+       as long as the slots of the buffer are larger than the bands) */
+    __wavelet2D_split_lines(wavelet, (void **) image, single);
+    if(wavelet->levels > 1)
+      __replay_previous(wavelet, (void **) image, single, 0);
   } else {
-    hlifting(pixels[1], high[0], -step[0],
-	     pixels[0] + pixels[2],
-	     pixels[0] + pixels[2],
-	     pixels[0] + pixels[0],
-	     w/2, h, 0);
+    /* the first level without the vertical split of the high band, nor
+       the overruns, which all fall on the HL and LH bands */
+    __lines_run(wavelet, image, 0, plan->width, plan->height, 0,
+		single ? __fhsplit_lines_task : __hsplit_lines_task);
+    __lines_run(wavelet, image, 0, (plan->width + 1) / 2, plan->height, 1,
+		single ? __fvsplit_lines_task : __vsplit_lines_task);
+    wavelet->level++;
+
+    while(wavelet->level < wavelet->levels)
+      __wavelet2D_split_lines(wavelet, (void **) image, single);
   }
 
+  if(single) __lines_to_double(image, wavelet->width, wavelet->height);
+
   return(0);
 }
 
-/* arrange the transformed coefficients in an image */
-/* where the top left corner contains the lowest band.  */
-static int __wavelet_flatten(it_wavelet2D_t *it_this, mat image)
+/* same thing on an image of floats of the size set beforehand */
+int it_wavelet2D_transform_float(it_wavelet2D_t *wavelet, float **image)
 {
-  int x, y, wf, hf, wc, hc, ps;
-  int width, height, level, page;
-  int levels;
-  double *band;
-  double *buffer = it_this->buffer;
+  assert(image);
 
-  width = it_this->width;
-  height = it_this->height;
-  levels = it_this->levels;
-  page = round_up(width, levels) * round_up(height, levels);
-  buffer = it_this->buffer + page;
-  ps = width;
+  if(!wavelet->width || !wavelet->height) return(-IT_EINVAL);
 
-  if(width != mat_width(image)) return(-IT_EINVAL);
-  if(height != mat_height(image)) return(-IT_EINVAL);
+  wavelet->level = 0;
 
-  hc = height;
-  wc = width;
+  while(wavelet->level < wavelet->levels)
+    __wavelet2D_split_lines(wavelet, (void **) image, 1);
 
-  for(level = 0; level < levels; level++) {
-    page = (round_up(width, levels) * round_up(height, levels)) >> level;
-    buffer = (it_this->buffer) + (page >> 1);
+  return(0);
+}
 
-    ps = (ps + 1) / 2; /* upper rounded */
-    hf = hc / 2;
-    hc = (hc + 1) / 2;
-    wf = wc / 2;
-    wc = (wc + 1) / 2;
-
-    band = buffer + 2*(page >> 2); /* HL */
-    for(y = 0; y < hc; y++)
-      for(x = 0; x < wf; x++)
-	image[y][x + wc] = band[y * wf + x];
-
-    band = buffer + 1*(page >> 2); /* LH */
-    for(y = 0; y < hf; y++)
-      for(x = 0; x < wc; x++)
-	image[y + hc][x] = band[y * wc + x];
-
-    band = buffer + 3*(page >> 2); /* HH */
-    for(y = 0; y < hf; y++)
-      for(x = 0; x < wf; x++)
-	image[y + hc][x + wc] = band[y * wf + x];
-  }
+int it_wavelet2D_itransform_float(it_wavelet2D_t *wavelet, float **image)
+{
+  assert(image);
+
+  if(!wavelet->width || !wavelet->height) return(-IT_EINVAL);
 
-  band = buffer; /* LL */
-  for(y = 0; y < hc; y++)
-    for(x = 0; x < wc; x++)
-      image[y][x] = band[y * wc + x];
+  wavelet->level = wavelet->levels;
+
+  while(wavelet->level)
+    __wavelet2D_merge_lines(wavelet, (void **) image, 1);
 
   return(0);
 }
 
-/* read the transformed coefficients from an image */
-/* where the top left corner contains the lowest band.  */
-static int __wavelet_unflatten(it_wavelet2D_t *it_this, mat image)
+/* PSNR of b against a (peak 255), infinite if they are equal */
+static double __psnr(mat a, mat b, int w, int h)
 {
-  int x, y, wf, hf, wc, hc, ps;
-  int width, height, level, page;
-  int levels;
-  double *band;
-  double *buffer = it_this->buffer;
+  double d, mse = 0;
+  int x, y;
 
-  width = it_this->width;
-  height = it_this->height;
-  levels = it_this->levels;
-  page = round_up(width, levels) * round_up(height, levels);
-  buffer = it_this->buffer + page;
-  ps = width;
+  for(y = 0; y < h; y++)
+    for(x = 0; x < w; x++) {
+      d = a[y][x] - b[y][x];
+      mse += d * d;
+    }
+  mse /= (double) w * h;
 
-  if(width != mat_width(image)) return(-IT_EINVAL);
-  if(height != mat_height(image)) return(-IT_EINVAL);
+  return(mse > 0 ? 10 * log10(255.0 * 255.0 / mse) : HUGE_VAL);
+}
 
-  /* we are given a fully decomposed image */
-  it_this->level = levels;
-  hc = height;
-  wc = width;
+/* compare the single precision with the double one on an image */
+int it_wavelet2D_precision_error(it_wavelet2D_t *wavelet, mat image,
+				 it_wavelet2D_error_t *error)
+{
+  int precision = wavelet->precision;
+  int w = wavelet->width, h = wavelet->height;
+  double d, psnr64;
+  mat m64, m32;
+  int x, y;
 
-  for(level = 0; level < levels; level++) {
-    page = (round_up(width, levels) * round_up(height, levels)) >> level;
-    buffer = (it_this->buffer) + (page >> 1);
+  if(__wavelet2D_check(wavelet, image)) return(-IT_EINVAL);
 
-    ps = (ps + 1) / 2; /* upper rounded */
-    hf = hc / 2;
-    hc = (hc + 1) / 2;
-    wf = wc / 2;
-    wc = (wc + 1) / 2;
-
-    band = buffer + 2*(page >> 2); /* HL */
-    for(y = 0; y < hc; y++)
-      for(x = 0; x < wf; x++)
-	band[y * wf + x] = image[y][x + wc];
-
-    band = buffer + 1*(page >> 2); /* LH */
-    for(y = 0; y < hf; y++)
-      for(x = 0; x < wc; x++)
-	band[y * wc + x] = image[y + hc][x];
-
-    band = buffer + 3*(page >> 2); /* HH */
-    for(y = 0; y < hf; y++)
-      for(x = 0; x < wf; x++)
-	band[y * wf + x] = image[y + hc][x + wc];
-  }
+  m64 = mat_clone(image);
+  m32 = mat_clone(image);
+
+  wavelet->precision = IT_WAVELET2D_F64;
+  it_wavelet2D_transform_inplace(wavelet, m64);
+  wavelet->precision = IT_WAVELET2D_F32;
+  it_wavelet2D_transform_inplace(wavelet, m32);
+
+  error->max_error = 0;
+  for(y = 0; y < h; y++)
+    for(x = 0; x < w; x++) {
+      d = fabs(m64[y][x] - m32[y][x]);
+      if(d > error->max_error) error->max_error = d;
+    }
+
+  wavelet->precision = IT_WAVELET2D_F64;
+  it_wavelet2D_itransform_inplace(wavelet, m64);
+  wavelet->precision = IT_WAVELET2D_F32;
+  it_wavelet2D_itransform_inplace(wavelet, m32);
+  wavelet->precision = precision;
 
-  band = buffer; /* LL */
-  for(y = 0; y < hc; y++)
-    for(x = 0; x < wc; x++)
-      band[y * wc + x] = image[y][x];
+  psnr64 = __psnr(image, m64, w, h);
+  error->psnr_delta = psnr64 - __psnr(image, m32, w, h);
+
+  /* the pixels written differently, at the rounding of mat_pgm_write */
+  error->changed_pixels = 0;
+  for(y = 0; y < h; y++)
+    for(x = 0; x < w; x++)
+      if(floor(m64[y][x] + 0.5) != floor(m32[y][x] + 0.5))
+	error->changed_pixels++;
+
+  mat_delete(m64);
+  mat_delete(m32);
 
   return(0);
 }
@@ -818,11 +1575,7 @@ static Mat __it_wavelet2D_transform(it_transform2D_t *transform,
 				    Mat __image)
 {
   it_wavelet2D_t *wavelet = IT_WAVELET2D(transform);
-  int x, y;
   int width, height;
-  int page;
-  int levels;
-  double *buffer;
   mat flat;
   mat image = (mat) __image;
   int free_on_exit = 0;
@@ -840,21 +1593,9 @@ static Mat __it_wavelet2D_transform(it_transform2D_t *transform,
     free_on_exit = 1;
   }
 
-  wavelet->level = 0; 
-
   flat = mat_new(height, width);
-  levels = wavelet->levels;
-  page = round_up(width, levels) * round_up(height, levels);
-  buffer = wavelet->buffer + page;
-
-  for(y = 0; y < height; y++)
-    for(x = 0; x < width; x++)
-      buffer[y * width + x] = image[y][x];
 
-  while(wavelet->level < levels)
-    __wavelet2D_split(wavelet);
-
-  __wavelet_flatten(IT_WAVELET2D(transform), flat);
+  it_wavelet2D_transform_into(wavelet, image, flat);
 
   if(free_on_exit)
     it_transform2D_clear_size(wavelet);    
@@ -868,10 +1609,6 @@ static Mat __it_wavelet2D_itransform(it_transform2D_t *transform,
 {
   it_wavelet2D_t *wavelet = IT_WAVELET2D(transform);
   int width, height;
-  int x, y;
-  int page;
-  int levels;
-  double *buffer;
   mat image;
   mat flat = (mat) __flat;
   int free_on_exit = 0;
@@ -890,18 +1627,8 @@ static Mat __it_wavelet2D_itransform(it_transform2D_t *transform,
   }
 
   image = mat_new(height, width);
-  levels = wavelet->levels;
-  page = round_up(width, levels) * round_up(height, levels);
-  buffer = wavelet->buffer + page;
-
-  __wavelet_unflatten(IT_WAVELET2D(transform), flat);
-
-  while(wavelet->level)
-    __wavelet2D_merge(wavelet);
 
-  for(y = 0; y < height; y++)
-    for(x = 0; x < width; x++)
-      image[y][x] = buffer[y * width + x];
+  it_wavelet2D_itransform_into(wavelet, flat, image);
 
   if(free_on_exit)
     it_transform2D_clear_size(wavelet);    
@@ -914,10 +1641,11 @@ static int __it_wavelet2D_copy(it_wavelet2D_t *it_this,
 {
   assert(it_this->levels == source->levels);
 
-  if(source->width && source->height) {
+  if(source->width && source->height)
     it_transform2D_set_size(it_this, source->width, source->height);
-    vec_copy(it_this->buffer, source->buffer);
-  }
+  if(source->buffer)
+    vec_copy(__wavelet2D_buffer(it_this), source->buffer);
+  it_this->precision = source->precision;
 
   return(0);
 }
@@ -935,10 +1663,16 @@ static void __wavelet2D_set_size(it_transform2D_t *transform,
   int levels = wavelet->levels;
 
   if(wavelet->width && wavelet->height)
+    free(wavelet->plan);
+  if(wavelet->buffer)
     vec_delete(wavelet->buffer);
+  if(wavelet->scratch)
+    vec_delete(wavelet->scratch);
+  wavelet->buffer = NULL;
+  wavelet->scratch = NULL;
 
   if(width && height)
-    wavelet->buffer = vec_new(2 * round_up(width, levels) * round_up(height, levels));
+    wavelet->plan = __plan_new(levels, width, height);
 
   wavelet->width = width;
   wavelet->height = height;
@@ -958,7 +1692,11 @@ static void __wavelet2D_destructor(it_object_t *it_this)
   it_wavelet2D_t *wavelet = IT_WAVELET2D(it_this);
 
   if(wavelet->width && wavelet->height)
+    free(wavelet->plan);
+  if(wavelet->buffer)
     vec_delete(wavelet->buffer);
+  if(wavelet->scratch)
+    vec_delete(wavelet->scratch);
 
   /* call the parent destructor */
   wavelet->it_overloaded(destructor)(it_this);
@@ -986,12 +1724,422 @@ it_instanciate(it_wavelet2D_t)
   it_this->levels = it_new_args_next(int);
   it_this->width = 0;
   it_this->height = 0;
+  it_this->plan = NULL;
+  it_this->buffer = NULL;
+  it_this->scratch = NULL;
+  it_this->precision = IT_WAVELET2D_F64;
   
   it_new_args_stop();
 
   return(it_this);
 }
 
+/*--------------------------------------------------------------------*/
+/* Line-based transform: a line received at a level is split at once
+   horizontally, into a ring of the last lines of the level, and the
+   vertical steps are run as in __vsplit_strip as soon as the lines they
+   need are there. The rows of the vertical low band are the lines of the
+   next level, the other rows are given out as soon as they are final.
+   The coefficients are those of the buffer-based transform: the samples
+   its scaling overruns into (see __replay_overruns) are all on the first
+   row of a band, and scaled here when that row is given out.          */
+
+/* lines kept per level, for count pairs of lifting steps */
+#define STREAM_RING(count) (2 * (count) + 4)
+
+struct _it_wavelet2D_stream_ {
+  it_wavelet_lifting_t const *lifting;
+  int levels;
+  it_wavelet2D_level_t *plan;    /* levels + 1 entries */
+  int ring;                      /* lines kept per level */
+  vec *rings;                    /* samples of the lines of each level */
+  double **lines;                /* ring lines of level l from l * ring */
+  int *received;                 /* lines received by each level */
+  int *time;                     /* next vertical step of each level */
+  it_wavelet2D_emit_t emit;
+  void *arg;
+};
+
+/* scales by c the samples f0 <= f < f1 of a row of n samples */
+static void __scale_row(double *row, int n, int f0, int f1, double c)
+{
+  if(f0 < 0) f0 = 0;
+  if(f1 > n) f1 = n;
+  if(f1 > f0) lifting_scale(row + f0, c, f1 - f0);
+}
+
+static void __stream_line(it_wavelet2D_stream_t *stream, int level,
+			  double const *x);
+
+/* run the vertical step t of a level and give out the rows it ends */
+static void __stream_time(it_wavelet2D_stream_t *stream, int level, int t)
+{
+  it_wavelet2D_level_t const *plan = stream->plan + level;
+  int w = plan->width, h = plan->height;
+  int nl = (w + 1) / 2, nh = w / 2;
+  int vl = (h + 1) / 2, vh = h / 2;
+  int slot = plan->page >> 2;
+  int count = stream->lifting->count / 2;
+  double scale = stream->lifting->scale;
+  lifting_rows_t r;
+  double *row;
+  int i;
+
+  r.band = r.vlow = r.vhigh = NULL;
+  r.p = 0;
+  r.lines = stream->lines + level * stream->ring;
+  r.ring = stream->ring;
+  r.col = 0;
+
+  /* both bands at once, the lines holding their low then high halves */
+  __vsplit_time(&r, h, stream->lifting->step, count, scale, w, t);
+
+  i = t - (count - 1);
+  if(i >= 0 && i < vl) {
+    row = low_row(&r, i);
+    if(i == 0)
+      __scale_row(row + nl, nh, nl * vh - slot, nl * (h + 1) / 2 - slot, 1.0/scale);
+    stream->emit(stream->arg, level, IT_WAVELET2D_HL, i, row + nl, nh);
+
+    if(level + 1 < stream->levels)
+      __stream_line(stream, level + 1, row);
+    else
+      stream->emit(stream->arg, level, IT_WAVELET2D_LL, i, row, nl);
+  }
+
+  i = t - count;
+  if(i >= 0 && i < vh) {
+    row = high_row(&r, i);
+    if(i == 0) {
+      __scale_row(row + nl, nh, nh * vl - slot, nh * (h + 1) / 2 - slot, scale);
+      lifting_scale(row + nl, 1.0/scale, nh);
+      __scale_row(row, nl, nl * vl - slot, nl * (h + 1) / 2 - slot, scale);
+      lifting_scale(row, 1.0/scale, nl);
+
+      /* overrun of the high band of the next level */
+      if(level + 1 < stream->levels) {
+	int h1 = plan[1].height, nh1 = plan[1].width / 2;
+	int slot1 = plan[1].page >> 2;
+
+	__scale_row(row, nl, nh1 * (h1 / 2) - slot1, nh1 * (h1 + 1) / 2 - slot1, 1.0/scale);
+      }
+    }
+    stream->emit(stream->arg, level, IT_WAVELET2D_LH, i, row, nl);
+    stream->emit(stream->arg, level, IT_WAVELET2D_HH, i, row + nl, nh);
+  }
+}
+
+/* receive the next line of a level */
+static void __stream_line(it_wavelet2D_stream_t *stream, int level,
+			  double const *x)
+{
+  it_wavelet2D_level_t const *plan = stream->plan + level;
+  int w = plan->width, h = plan->height;
+  int count = stream->lifting->count / 2;
+  int y = stream->received[level]++;
+  double *line = stream->lines[level * stream->ring + y % stream->ring];
+  int t, last;
+
+  __hsplit_line(x, line, line + (w + 1) / 2, w, stream->lifting->step,
+		count, stream->lifting->scale);
+
+  /* the steps of time t need the lines up to 2t+2 */
+  for(t = stream->time[level]; t < (h + 1) / 2 + count; t++) {
+    last = (2 * t + 2 < h - 1) ? 2 * t + 2 : h - 1;
+    if(last > y) break;
+    __stream_time(stream, level, t);
+  }
+  stream->time[level] = t;
+}
+
+it_wavelet2D_stream_t *it_wavelet2D_stream_new(it_wavelet_lifting_t const *lifting,
+					       int levels, int width, int height,
+					       it_wavelet2D_emit_t emit, void *arg)
+{
+  it_wavelet2D_stream_t *stream;
+  int level, j;
+
+  assert(width > 0 && height > 0);
+
+  stream = (it_wavelet2D_stream_t *) malloc(sizeof(it_wavelet2D_stream_t));
+  it_assert( stream != NULL, "No enough memory to allocate the stream" );
+
+  stream->lifting = lifting;
+  stream->levels = levels;
+  stream->plan = __plan_new(levels, width, height);
+  stream->ring = STREAM_RING(lifting->count / 2);
+  stream->rings = (vec *) malloc(levels * sizeof(vec));
+  stream->lines = (double **) malloc(levels * stream->ring * sizeof(double *));
+  stream->received = (int *) calloc(levels, sizeof(int));
+  stream->time = (int *) calloc(levels, sizeof(int));
+  Vec_alloc_account(sizeof(it_wavelet2D_stream_t));
+  Vec_alloc_account(levels * sizeof(vec));
+  Vec_alloc_account(levels * stream->ring * sizeof(double *));
+  Vec_alloc_account(levels * sizeof(int));
+  Vec_alloc_account(levels * sizeof(int));
+  stream->emit = emit;
+  stream->arg = arg;
+
+  for(level = 0; level < levels; level++) {
+    int w = stream->plan[level].width;
+
+    stream->rings[level] = vec_new(stream->ring * w);
+    for(j = 0; j < stream->ring; j++)
+      stream->lines[level * stream->ring + j] = stream->rings[level] + j * w;
+  }
+
+  return(stream);
+}
+
+int it_wavelet2D_stream_push(it_wavelet2D_stream_t *stream, double const *line)
+{
+  if(stream->received[0] == stream->plan[0].height) return(-IT_EINVAL);
+
+  if(stream->levels)
+    __stream_line(stream, 0, line);
+  else
+    stream->emit(stream->arg, 0, IT_WAVELET2D_LL, stream->received[0]++,
+		 line, stream->plan[0].width);
+
+  return(0);
+}
+
+void it_wavelet2D_stream_delete(it_wavelet2D_stream_t *stream)
+{
+  int level;
+
+  for(level = 0; level < stream->levels; level++)
+    vec_delete(stream->rings[level]);
+
+  free(stream->rings);
+  free(stream->lines);
+  free(stream->received);
+  free(stream->time);
+  free(stream->plan);
+  free(stream);
+}
+
+/*--------------------------------------------------------------------*/
+/* Reversible integer 5/3 transform (JPEG 2000). The steps
+     high[i] -= floor((low[i] + low[i+1]) / 2)
+     low[i]  += floor((high[i-1] + high[i] + 2) / 4)
+   are computed exactly on int, with the same mirrored boundaries and in
+   the same layout as the transform of doubles, and undone exactly by the
+   inverse; there is no scaling. The image is filtered in place, line by
+   line then by strips of columns, as by it_wavelet2D_transform_inplace. */
+
+typedef struct _ilifting_pass_ {
+  int **lines;                   /* lines of the image */
+  int width, height;             /* of the level */
+  int size;                      /* lines or columns per task */
+  int *scratch;                  /* scratch_size per task */
+  int scratch_size;
+} ilifting_pass_t;
+
+/* __hlift on integers: d[i] += sign * ((a[i-1+odd] + a[i+odd] + add) >> shift) */
+static void __ilift(int *d, int const *a, int na, int odd,
+		    int add, int shift, int sign, int i0, int i1)
+{
+  int i, n, v;
+
+  if(!na) return; /* a single sample */
+
+  for(i = i0; i < i1; i++) {
+    if(i >= 1 - odd && i < na - odd) {
+      n = ((i1 < na - odd) ? i1 : na - odd) - i;
+      lifting_istep(d + i, d + i, a + i - 1 + odd, a + i + odd,
+		    add, shift, sign, n);
+      i += n - 1;
+    } else {
+      v = (a[mirror(i-1+odd, na)] + a[mirror(i+odd, na)] + add) >> shift;
+      d[i] = (sign > 0) ? d[i] + v : d[i] - v;
+    }
+  }
+}
+
+/* the predict step, then the update step, by chunks: the update of a
+   chunk only needs the high samples predicted up to it */
+static void __isplit_line(int *x, int *low, int *high, int w)
+{
+  int t, i1;
+  int nl = (w + 1) / 2;
+  int nh = w / 2;
+  int chunk = 2 * __strip_width(1);
+
+  lifting_isplit(low, high, x, w);
+
+  for(t = 0; t < nl; t += chunk) {
+    i1 = (t + chunk < nh) ? t + chunk : nh;
+    if(i1 > t) __ilift(high, low, nl, 1, 0, 1, -1, t, i1);
+    i1 = (t + chunk < nl) ? t + chunk : nl;
+    __ilift(low, high, nh, 0, 2, 2, 1, t, i1);
+  }
+
+  memcpy(x, low, nl * sizeof(int));
+  memcpy(x + nl, high, nh * sizeof(int));
+}
+
+static void __imerge_line(int *x, int *low, int *high, int w)
+{
+  int t, i1;
+  int nl = (w + 1) / 2;
+  int nh = w / 2;
+  int chunk = 2 * __strip_width(1);
+
+  memcpy(low, x, nl * sizeof(int));
+  memcpy(high, x + nl, nh * sizeof(int));
+
+  /* the high samples of a chunk need the next low sample */
+  for(t = 0; t < nl; t += chunk) {
+    i1 = (t + chunk + 1 < nl) ? t + chunk + 1 : nl;
+    __ilift(low, high, nh, 0, 2, 2, -1, (t ? t + 1 : 0), i1);
+    i1 = (t + chunk < nh) ? t + chunk : nh;
+    if(i1 > t) __ilift(high, low, nl, 1, 0, 1, 1, t, i1);
+  }
+
+  lifting_imerge(x, low, high, w);
+}
+
+static void __isplit_lines_task(void *arg, int t)
+{
+  ilifting_pass_t *pass = (ilifting_pass_t *) arg;
+  int y, y1 = (t + 1) * pass->size;
+  int *low = pass->scratch + t * pass->scratch_size;
+
+  if(y1 > pass->height) y1 = pass->height;
+
+  for(y = t * pass->size; y < y1; y++)
+    __isplit_line(pass->lines[y], low, low + (pass->width + 1) / 2,
+		  pass->width);
+}
+
+static void __imerge_lines_task(void *arg, int t)
+{
+  ilifting_pass_t *pass = (ilifting_pass_t *) arg;
+  int y, y1 = (t + 1) * pass->size;
+  int *low = pass->scratch + t * pass->scratch_size;
+
+  if(y1 > pass->height) y1 = pass->height;
+
+  for(y = t * pass->size; y < y1; y++)
+    __imerge_line(pass->lines[y], low, low + (pass->width + 1) / 2,
+		  pass->width);
+}
+
+/* rows i of the low and high bands of a strip, in place */
+#define ilow_row(pass, i, x)  ((pass)->lines[2*(i)] + (x))
+#define ihigh_row(pass, i, x) ((pass)->lines[2*(i)+1] + (x))
+
+/* at time t, high row t is predicted, then low row t updated */
+static void __isplit_strip_task(void *arg, int t)
+{
+  ilifting_pass_t *pass = (ilifting_pass_t *) arg;
+  int h = pass->height, nl = (h + 1) / 2, nh = h / 2;
+  int x = t * pass->size;
+  int n = (pass->width - x < pass->size) ? pass->width - x : pass->size;
+  int i;
+
+  for(i = 0; i < nl; i++) {
+    if(i < nh)
+      lifting_istep(ihigh_row(pass, i, x), ihigh_row(pass, i, x),
+		    ilow_row(pass, i, x), ilow_row(pass, mirror(i+1, nl), x),
+		    0, 1, -1, n);
+    if(nh)
+      lifting_istep(ilow_row(pass, i, x), ilow_row(pass, i, x),
+		    ihigh_row(pass, mirror(i-1, nh), x),
+		    ihigh_row(pass, mirror(i, nh), x), 2, 2, 1, n);
+  }
+
+  __unshuffle((void **) pass->lines, x * sizeof(int), n * sizeof(int), h,
+	      pass->scratch + t * pass->scratch_size, 0);
+}
+
+/* at time t, low row t is restored, then high row t-1 */
+static void __imerge_strip_task(void *arg, int t)
+{
+  ilifting_pass_t *pass = (ilifting_pass_t *) arg;
+  int h = pass->height, nl = (h + 1) / 2, nh = h / 2;
+  int x = t * pass->size;
+  int n = (pass->width - x < pass->size) ? pass->width - x : pass->size;
+  int i;
+
+  __unshuffle((void **) pass->lines, x * sizeof(int), n * sizeof(int), h,
+	      pass->scratch + t * pass->scratch_size, 1);
+
+  for(i = 0; i <= nl; i++) {
+    if(i < nl && nh)
+      lifting_istep(ilow_row(pass, i, x), ilow_row(pass, i, x),
+		    ihigh_row(pass, mirror(i-1, nh), x),
+		    ihigh_row(pass, mirror(i, nh), x), 2, 2, -1, n);
+    if(i >= 1 && i - 1 < nh)
+      lifting_istep(ihigh_row(pass, i-1, x), ihigh_row(pass, i-1, x),
+		    ilow_row(pass, i-1, x), ilow_row(pass, mirror(i, nl), x),
+		    0, 1, 1, n);
+  }
+}
+
+/* in-place filtering of the w x h samples at the top left of the lines */
+static void __ilines_run(int **lines, int w, int h, int vertical,
+			 void (*task)(void *arg, int t))
+{
+  ilifting_pass_t pass;
+  ivec scratch;
+  int n = vertical ? w : h;
+  int n_tasks;
+
+  pass.lines = lines;
+  pass.width = w;
+  pass.height = h;
+
+  if(vertical) {
+    pass.size = __task_size(w, 16);
+    if(pass.size > 2 * __strip_width(1))
+      pass.size = 2 * __strip_width(1);
+    pass.scratch_size = pass.size + (h + sizeof(int) - 1) / sizeof(int);
+  } else {
+    pass.size = __task_size(h, 1);
+    pass.scratch_size = w;
+  }
+
+  n_tasks = (n + pass.size - 1) / pass.size;
+  scratch = ivec_new(n_tasks * pass.scratch_size);
+  pass.scratch = scratch;
+
+  __tasks_run(w * h, n_tasks, task, &pass);
+
+  ivec_delete(scratch);
+}
+
+int it_wavelet2D_53i_transform(imat image, int levels)
+{
+  int l, w, h;
+
+  for(l = 0; l < levels; l++) {
+    w = shift_up(imat_width(image), l);
+    h = shift_up(imat_height(image), l);
+
+    __ilines_run(image, w, h, 0, __isplit_lines_task);
+    __ilines_run(image, w, h, 1, __isplit_strip_task);
+  }
+
+  return(0);
+}
+
+int it_wavelet2D_53i_itransform(imat image, int levels)
+{
+  int l, w, h;
+
+  for(l = levels - 1; l >= 0; l--) {
+    w = shift_up(imat_width(image), l);
+    h = shift_up(imat_height(image), l);
+
+    __ilines_run(image, w, h, 1, __imerge_strip_task);
+    __ilines_run(image, w, h, 0, __imerge_lines_task);
+  }
+
+  return(0);
+}
+
 /*--------------------------------------------------------------------*/
 mat * it_wavelet2D_split( mat wav, int nb_levels ) {
   int mid_row, mid_col, nb_row, nb_col, l;
@@ -1005,6 +2153,7 @@ mat * it_wavelet2D_split( mat wav, int nb_levels ) {
   mid_col = ( nb_col + 1 ) / 2;
 
   subbands = (mat *) malloc( sizeof( mat ) * ( 3 * nb_levels + 1 ) );
+  Vec_alloc_account( sizeof( mat ) * ( 3 * nb_levels + 1 ) );
   
   for( l = nb_levels ; l > 0 ; l-- ) {
     subbands[ l * 3 - 2 ] = mat_get_submatrix( wav, 0, mid_col, mid_row - 1, nb_col - 1 );
@@ -1017,20 +2166,44 @@ mat * it_wavelet2D_split( mat wav, int nb_levels ) {
     mid_col = ( nb_col + 1 ) / 2;
   }
 
-  subbands[ 0 ] = mat_get_submatrix( wav, 0, 0, nb_col - 1, nb_row - 1 );
+  subbands[ 0 ] = mat_get_submatrix( wav, 0, 0, nb_row - 1, nb_col - 1 );
   return subbands;
 }
 
+void it_wavelet2D_split_view( mat_view wav, int nb_levels, mat_view * subbands ) {
+  int mid_row, mid_col, nb_row, nb_col, l;
+
+  assert( subbands );
+
+  nb_row = wav.height;
+  nb_col = wav.width;
+  mid_row = ( nb_row + 1 ) / 2;
+  mid_col = ( nb_col + 1 ) / 2;
+
+  for( l = nb_levels ; l > 0 ; l-- ) {
+    subbands[ l * 3 - 2 ] = mat_view_get_submatrix( wav, 0, mid_col, mid_row - 1, nb_col - 1 );
+    subbands[ l * 3 - 1 ] = mat_view_get_submatrix( wav, mid_row, 0, nb_row - 1, mid_col - 1 );
+    subbands[ l * 3 ]     = mat_view_get_submatrix( wav, mid_row, mid_col, nb_row - 1, nb_col - 1 );
+
+    nb_row = mid_row;
+    nb_col = mid_col;
+    mid_row = ( nb_row + 1 ) / 2;
+    mid_col = ( nb_col + 1 ) / 2;
+  }
+
+  subbands[ 0 ] = mat_view_get_submatrix( wav, 0, 0, nb_row - 1, nb_col - 1 );
+}
+
 mat it_wavelet2D_merge( mat * subbands, int nb_levels ) {
   int mid_row, mid_col, nb_row, nb_col, l;
   mat wav;
 
   assert( subbands );
 
-  wav = mat_new( mat_width( subbands[ nb_levels * 3 ] ) 
-		     + mat_width( subbands[ nb_levels * 3 - 1 ] ),
-		     mat_height( subbands[ nb_levels * 3 ] ) 
-		     + mat_height( subbands[ nb_levels * 3 - 2 ] ) ); 
+  wav = mat_new( mat_height( subbands[ nb_levels * 3 ] ) 
+		     + mat_height( subbands[ nb_levels * 3 - 2 ] ),
+		     mat_width( subbands[ nb_levels * 3 ] ) 
+		     + mat_width( subbands[ nb_levels * 3 - 1 ] ) ); 
 
   nb_row = mat_height( wav );
   nb_col = mat_width( wav );
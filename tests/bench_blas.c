@@ -0,0 +1,26 @@
+/*
+  Timing of the vector BLAS-1 kernels.
+
+  Usage: bench_blas [samples [runs]]
+  Prints the time per sample of each kernel for every instruction set the
+  processor supports, with ordered and blocked reductions (see blas.h).
+*/
+
+#include <stdlib.h>
+
+#include "../include/blas.h"
+
+#define SAMPLES 4096
+#define RUNS    2000
+
+int main(int argc, char **argv)
+{
+  int n = (argc > 1) ? atoi(argv[1]) : SAMPLES;
+  int repeat = (argc > 2) ? atoi(argv[2]) : RUNS;
+
+  if(n <= 0 || repeat <= 0)
+    return(1);
+
+  blas_benchmark(n, repeat);
+  return(0);
+}
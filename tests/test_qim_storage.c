@@ -0,0 +1,120 @@
+/*
+  Embedding and detection with stored carriers of each element type.
+
+  The carriers are drawn in double (QIM_F64) or packed in float and int8
+  (QIM_F32, QIM_I8), orthonormalized or not. The bits are embedded with
+  the sequential and the joint engines, then detected on carriers drawn
+  again from the same seed, as the extractor does: every bit must come
+  back.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/vec.h"
+#include "../include/random.h"
+#include "../include/qim.h"
+
+#define DIM     20011
+#define NB_BITS 40
+#define PAS     20.0
+#define SEED    1234
+
+static char const *type_names[] = { "F64", "F32", "I8" };
+
+/* carriers in double, as the mains draw them */
+static vec *draw_carriers(int ortho)
+{
+  vec *carriers = (vec *) malloc(sizeof(vec) * NB_BITS);
+  int i;
+
+  it_seed(SEED);
+  for(i = 0; i < NB_BITS; i++) {
+    carriers[i] = vec_new(DIM);
+    vec_randn(carriers[i]);
+    vec_normalize(carriers[i], 2);
+  }
+  if(ortho) qim_orthonormalize(carriers, NB_BITS);
+
+  return(carriers);
+}
+
+static void delete_carriers(vec *carriers)
+{
+  int i;
+
+  for(i = 0; i < NB_BITS; i++)
+    vec_delete(carriers[i]);
+  free(carriers);
+}
+
+static qim_packed_t *draw_packed(int type, int ortho)
+{
+  it_seed(SEED);
+  return(qim_packed_randn(NB_BITS, DIM, type, ortho));
+}
+
+/* number of bits of mot not detected in the marked host */
+static int embed_detect(vec host, int *mot, int type, int ortho, int joint)
+{
+  vec marked = vec_clone(host);
+  int detected[NB_BITS];
+  qim_packed_t *p;
+  vec *carriers;
+  int i, errors = 0;
+
+  if(type == QIM_F64) {
+    carriers = draw_carriers(ortho);
+    if(joint) qim_embed_joint(marked, carriers, mot, NB_BITS, PAS);
+    else qim_embed(marked, carriers, mot, NB_BITS, PAS);
+    delete_carriers(carriers);
+
+    carriers = draw_carriers(ortho);
+    qim_detect(marked, carriers, detected, NB_BITS, PAS);
+    delete_carriers(carriers);
+  }
+  else {
+    p = draw_packed(type, ortho);
+    if(joint) qim_embed_joint_packed(marked, p, mot, PAS);
+    else qim_embed_packed(marked, p, mot, PAS);
+    qim_packed_delete(p);
+
+    p = draw_packed(type, ortho);
+    qim_detect_packed(marked, p, detected, PAS);
+    qim_packed_delete(p);
+  }
+
+  for(i = 0; i < NB_BITS; i++)
+    if(detected[i] != mot[i]) errors++;
+
+  vec_delete(marked);
+  return(errors);
+}
+
+int main(void)
+{
+  int mot[NB_BITS];
+  int type, ortho, joint, errors, failed = 0;
+  vec host;
+  int i;
+
+  it_seed(1);
+  host = vec_new(DIM);
+  for(i = 0; i < DIM; i++)
+    host[i] = 255 * it_rand();
+  for(i = 0; i < NB_BITS; i++)
+    mot[i] = (it_rand() < 0.5);
+
+  for(type = QIM_F64; type <= QIM_I8; type++)
+    for(ortho = 0; ortho < 2; ortho++)
+      for(joint = 0; joint < 2; joint++) {
+	errors = embed_detect(host, mot, type, ortho, joint);
+	printf("%s%s%s: %d wrong bits out of %d%s\n", type_names[type],
+	       ortho ? ", orthonormalized" : "", joint ? ", joint" : "",
+	       errors, NB_BITS, errors ? "  FAILED" : "");
+	if(errors) failed++;
+      }
+
+  vec_delete(host);
+  return(failed != 0);
+}
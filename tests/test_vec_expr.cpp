@@ -0,0 +1,87 @@
+/*
+  Vector expressions against the kernels they stand for.
+
+  it::ref( y ) = a * it::ref( x ) + b * it::ref( y ) must give the values
+  of vec_axpby, it::ref( y ) += a * it::ref( x ) those of vec_axpy, and
+  it::dot the sums of blas_dot, exactly, for ordered and blocked
+  reductions and every instruction set the processor supports.
+*/
+
+#include <stdio.h>
+
+#include "../include/vec.h"
+#include "../include/blas.h"
+#include "../include/vec_expr.h"
+
+#define A 0.7
+#define B -1.3
+
+/* lengths around the lanes of the blocked sums and the vector widths */
+static int const lengths[] = { 0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 64, 1000, 1003 };
+
+static void fill( vec v, int seed )
+{
+  idx_t j;
+
+  for( j = 0 ; j < vec_length( v ) ; j++ )
+    v[ j ] = ( ( j * 37 + seed * 11 ) % 101 ) / 7.0 - 6.5;
+}
+
+/* number of samples or sums differing from those of the kernels */
+static int compare( int n )
+{
+  vec x = vec_new( n ), y = vec_new( n ), ye = vec_new( n ), yk = vec_new( n );
+  int errors = 0;
+  idx_t j;
+
+  fill( x, 1 );
+  fill( y, 2 );
+
+  vec_copy( ye, y );
+  vec_copy( yk, y );
+  it::ref( ye ) = A * it::ref( x ) + B * it::ref( ye );
+  vec_axpby( yk, A, x, B );
+  for( j = 0 ; j < n ; j++ )
+    if( ye[ j ] != yk[ j ] ) errors++;
+
+  vec_copy( ye, y );
+  vec_copy( yk, y );
+  it::ref( ye ) += A * it::ref( x );
+  vec_axpy( yk, A, x );
+  for( j = 0 ; j < n ; j++ )
+    if( ye[ j ] != yk[ j ] ) errors++;
+
+  if( it::dot( it::ref( x ), it::ref( y ) ) != blas_dot( x, y, n ) ) errors++;
+  if( it::dot( it::ref( x ), it::ref( x ) ) != blas_dot( x, x, n ) ) errors++;
+
+  vec_delete( yk );
+  vec_delete( ye );
+  vec_delete( y );
+  vec_delete( x );
+  return( errors );
+}
+
+int main( void )
+{
+  static char const * isa_names[] = { "C", "SSE2", "AVX", "AVX-512" };
+  int isa, mode, i, errors, failed = 0;
+
+  for( isa = BLAS_C ; isa <= BLAS_AVX512 ; isa++ ) {
+    if( blas_set_isa( isa ) != isa )
+      continue;
+
+    for( mode = BLAS_ORDERED ; mode <= BLAS_BLOCKED ; mode++ ) {
+      blas_set_mode( mode );
+      errors = 0;
+      for( i = 0 ; i < (int) ( sizeof( lengths ) / sizeof( lengths[ 0 ] ) ) ; i++ )
+	errors += compare( lengths[ i ] );
+
+      printf( "%s, %s sums: %d differences%s\n", isa_names[ isa ],
+	      mode == BLAS_ORDERED ? "ordered" : "blocked", errors,
+	      errors ? "  FAILED" : "" );
+      if( errors ) failed++;
+    }
+  }
+
+  return( failed != 0 );
+}
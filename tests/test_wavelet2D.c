@@ -0,0 +1,75 @@
+/*
+  Reconstruction of the 2D wavelet transform.
+
+  The deep levels of small images have lines of 1 to 3 samples, where
+  both ends of a line are mirrored from the same samples. Each image
+  size below reaches such lines with its number of levels; the image
+  must come back from its coefficients.
+*/
+
+#include <stdio.h>
+#include <math.h>
+
+#include "../include/mat.h"
+#include "../include/wavelet.h"
+#include "../include/wavelet2D.h"
+
+/* largest error allowed on pixels of 0 to 255 */
+#define TOLERANCE 1e-9
+
+/* width, height and levels */
+static int const sizes[][3] = {
+  { 2, 2, 1 }, { 3, 3, 1 }, { 6, 6, 2 }, { 5, 7, 2 }, { 7, 5, 2 },
+  { 64, 64, 6 }, { 37, 43, 5 }, { 512, 512, 5 }
+};
+
+static double reconstruction_error(it_wavelet_lifting_t const *lifting,
+				   int width, int height, int levels)
+{
+  mat image, coefs, back;
+  double d, error = 0;
+  int x, y;
+
+  image = mat_new(height, width);
+  for(y = 0; y < height; y++)
+    for(x = 0; x < width; x++)
+      image[y][x] = (37 * x + 101 * y + 13 * x * y) % 256;
+
+  coefs = it_dwt2D(image, lifting, levels);
+  back = it_idwt2D(coefs, lifting, levels);
+
+  for(y = 0; y < height; y++)
+    for(x = 0; x < width; x++) {
+      d = fabs(back[y][x] - image[y][x]);
+      if(d > error) error = d;
+    }
+
+  mat_delete(back);
+  mat_delete(coefs);
+  mat_delete(image);
+
+  return(error);
+}
+
+int main(void)
+{
+  it_wavelet_lifting_t const *liftings[2];
+  char const *names[2] = { "9/7", "5/3" };
+  int i, l, failed = 0;
+  double error;
+
+  liftings[0] = it_wavelet_lifting_97;
+  liftings[1] = it_wavelet_lifting_53;
+
+  for(l = 0; l < 2; l++)
+    for(i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+      error = reconstruction_error(liftings[l], sizes[i][0], sizes[i][1],
+				   sizes[i][2]);
+      printf("%s %dx%d, %d levels: error %g%s\n", names[l],
+	     sizes[i][0], sizes[i][1], sizes[i][2], error,
+	     error < TOLERANCE ? "" : "  FAILED");
+      if(!(error < TOLERANCE)) failed++;
+    }
+
+  return(failed != 0);
+}
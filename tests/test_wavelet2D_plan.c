@@ -0,0 +1,81 @@
+/*
+  Allocations of a 2D wavelet transform plan.
+
+  Once a plan has transformed an image of its size, it keeps its buffer
+  and its scratch: transforming again into a matrix of this size, or in
+  place, in double and in single precision, must not allocate anything,
+  Vec_alloc_count and Vec_alloc_bytes being left unchanged.
+*/
+
+#include <stdio.h>
+
+#include "../include/mat.h"
+#include "../include/wavelet.h"
+#include "../include/wavelet2D.h"
+
+#define REPEAT 10
+
+/* width, height and levels */
+static int const sizes[][3] = {
+  { 512, 512, 5 }, { 37, 43, 3 }, { 300, 200, 4 }
+};
+
+/* the transforms of one size, run once */
+static void transform_all(it_wavelet2D_t *plan, mat image, mat flat)
+{
+  it_wavelet2D_transform_into(plan, image, flat);
+  it_wavelet2D_itransform_into(plan, flat, image);
+
+  it_wavelet2D_set_precision(plan, IT_WAVELET2D_F64);
+  it_wavelet2D_transform_inplace(plan, image);
+  it_wavelet2D_itransform_inplace(plan, image);
+
+  it_wavelet2D_set_precision(plan, IT_WAVELET2D_F32);
+  it_wavelet2D_transform_inplace(plan, image);
+  it_wavelet2D_itransform_inplace(plan, image);
+}
+
+int main(void)
+{
+  it_wavelet_lifting_t const *liftings[2];
+  char const *names[2] = { "9/7", "5/3" };
+  it_wavelet2D_t *plan;
+  mat image, flat;
+  unsigned long count;
+  size_t bytes;
+  int i, l, r, x, y, failed = 0;
+
+  liftings[0] = it_wavelet_lifting_97;
+  liftings[1] = it_wavelet_lifting_53;
+
+  for(l = 0; l < 2; l++)
+    for(i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+      int width = sizes[i][0], height = sizes[i][1];
+
+      image = mat_new(height, width);
+      flat = mat_new(height, width);
+      for(y = 0; y < height; y++)
+	for(x = 0; x < width; x++)
+	  image[y][x] = (37 * x + 101 * y + 13 * x * y) % 256;
+
+      plan = it_wavelet2D_plan(liftings[l], sizes[i][2], width, height);
+      transform_all(plan, image, flat);
+
+      count = Vec_alloc_count;
+      bytes = Vec_alloc_bytes;
+      for(r = 0; r < REPEAT; r++)
+	transform_all(plan, image, flat);
+
+      printf("%s %dx%d, %d levels: %lu blocks, %lu bytes allocated%s\n",
+	     names[l], width, height, sizes[i][2], Vec_alloc_count - count,
+	     (unsigned long) (Vec_alloc_bytes - bytes),
+	     Vec_alloc_count == count && Vec_alloc_bytes == bytes ? "" : "  FAILED");
+      if(Vec_alloc_count != count || Vec_alloc_bytes != bytes) failed++;
+
+      it_delete(plan);
+      mat_delete(flat);
+      mat_delete(image);
+    }
+
+  return(failed != 0);
+}
@@ -0,0 +1,79 @@
+/*
+  Split of the 2D wavelet coefficients into subbands, and merge.
+
+  On images that are not square, with odd sizes and several levels, the
+  subbands copied by it_wavelet2D_split must have the size and samples of
+  those seen in place by it_wavelet2D_split_view, and it_wavelet2D_merge
+  must put them back into the same coefficients.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/mat.h"
+#include "../include/wavelet2D.h"
+
+/* height, width and levels */
+static int const sizes[][3] = {
+  { 64, 64, 3 }, { 48, 80, 3 }, { 80, 48, 3 }, { 37, 43, 4 }, { 43, 37, 4 },
+  { 5, 12, 2 }, { 12, 5, 2 }
+};
+
+/* differences between the split, the views and the merge */
+static int compare(int height, int width, int levels)
+{
+  int n = 3 * levels + 1;
+  mat_view *views = (mat_view *) malloc(sizeof(mat_view) * n);
+  mat wav, back, *subbands;
+  int errors = 0, i, x, y;
+
+  wav = mat_new(height, width);
+  for(y = 0; y < height; y++)
+    for(x = 0; x < width; x++)
+      wav[y][x] = y * width + x;
+
+  subbands = it_wavelet2D_split(wav, levels);
+  it_wavelet2D_split_view(mat_get_view(wav), levels, views);
+
+  for(i = 0; i < n; i++) {
+    if(mat_height(subbands[i]) != views[i].height
+       || mat_width(subbands[i]) != views[i].width) {
+      errors++;
+      continue;
+    }
+    for(y = 0; y < views[i].height; y++)
+      for(x = 0; x < views[i].width; x++)
+	if(subbands[i][y][x] != _mat_view(views[i], y, x)) errors++;
+  }
+
+  back = it_wavelet2D_merge(subbands, levels);
+  if(mat_height(back) != height || mat_width(back) != width)
+    errors++;
+  else
+    for(y = 0; y < height; y++)
+      for(x = 0; x < width; x++)
+	if(back[y][x] != wav[y][x]) errors++;
+
+  mat_delete(back);
+  for(i = 0; i < n; i++)
+    mat_delete(subbands[i]);
+  free(subbands);
+  free(views);
+  mat_delete(wav);
+
+  return(errors);
+}
+
+int main(void)
+{
+  int i, errors, failed = 0;
+
+  for(i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+    errors = compare(sizes[i][0], sizes[i][1], sizes[i][2]);
+    printf("%dx%d, %d levels: %d differences%s\n", sizes[i][1], sizes[i][0],
+	   sizes[i][2], errors, errors ? "  FAILED" : "");
+    if(errors) failed++;
+  }
+
+  return(failed != 0);
+}
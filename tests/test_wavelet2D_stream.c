@@ -0,0 +1,128 @@
+/*
+  Line-based 2D wavelet transform against the whole-image one.
+
+  Each image is written as a pgm file line by line, then read back line
+  by line and given to a stream, the rows given out being put at their
+  place in the layout of it_wavelet2D_transform_into: the coefficients
+  must be exactly those of the transform of the image read at once, for
+  every size below, 1 to 6 levels and both filters.
+*/
+
+#include <stdio.h>
+#include <math.h>
+
+#include "../include/mat.h"
+#include "../include/io.h"
+#include "../include/wavelet.h"
+#include "../include/wavelet2D.h"
+
+#define FILENAME "test_wavelet2D_stream.pgm"
+
+/* width and height */
+static int const sizes[][2] = {
+  { 1, 1 }, { 2, 2 }, { 3, 3 }, { 5, 7 }, { 7, 5 }, { 8, 8 }, { 16, 9 },
+  { 33, 17 }, { 37, 43 }, { 64, 64 }, { 100, 60 }, { 129, 130 }, { 256, 192 }
+};
+
+/* the rows given out, put in the layout of the whole-image transform */
+typedef struct {
+  mat flat;
+  it_wavelet2D_level_t levels[8];
+} layout_t;
+
+static void put_row(void *arg, int level, int band, int row,
+		    double const *samples, int width)
+{
+  layout_t *l = (layout_t *) arg;
+  int w = l->levels[level].width, h = l->levels[level].height;
+  int x0 = 0, y0 = 0, x;
+
+  if(band == IT_WAVELET2D_HL || band == IT_WAVELET2D_HH) x0 = (w + 1) / 2;
+  if(band == IT_WAVELET2D_LH || band == IT_WAVELET2D_HH) y0 = (h + 1) / 2;
+
+  for(x = 0; x < width; x++)
+    l->flat[y0 + row][x0 + x] = samples[x];
+}
+
+static double stream_error(it_wavelet_lifting_t const *lifting,
+			   int width, int height, int levels)
+{
+  it_wavelet2D_stream_t *stream;
+  it_wavelet2D_t *plan;
+  mat image, flat;
+  layout_t l;
+  FILE *F;
+  vec line;
+  double d, error = 0;
+  int w, h, x, y;
+
+  image = mat_new(height, width);
+  for(y = 0; y < height; y++)
+    for(x = 0; x < width; x++)
+      image[y][x] = (37 * x + 101 * y + 13 * x * y) % 256;
+
+  /* the image written and read back line by line */
+  line = vec_new(width);
+  F = pgm_write_open(FILENAME, width, height);
+  for(y = 0; y < height; y++) {
+    vec_copy_mem(line, image[y]);
+    vec_pgm_write_line(F, line);
+  }
+  fclose(F);
+
+  l.flat = mat_new_zeros(height, width);
+  for(y = 0; y <= levels; y++) {
+    l.levels[y].width = (width + (1 << y) - 1) >> y;
+    l.levels[y].height = (height + (1 << y) - 1) >> y;
+  }
+  stream = it_wavelet2D_stream_new(lifting, levels, width, height, put_row, &l);
+  F = pgm_read_open(FILENAME, &w, &h);
+  for(y = 0; y < h; y++) {
+    vec_pgm_read_line(F, line);
+    it_wavelet2D_stream_push(stream, line);
+  }
+  fclose(F);
+  remove(FILENAME);
+  it_wavelet2D_stream_delete(stream);
+
+  flat = mat_new(height, width);
+  plan = it_wavelet2D_plan(lifting, levels, width, height);
+  it_wavelet2D_transform_into(plan, image, flat);
+
+  for(y = 0; y < height; y++)
+    for(x = 0; x < width; x++) {
+      d = fabs(l.flat[y][x] - flat[y][x]);
+      if(!(d <= error)) error = d;
+    }
+
+  it_delete(plan);
+  mat_delete(flat);
+  mat_delete(l.flat);
+  vec_delete(line);
+  mat_delete(image);
+
+  return(error);
+}
+
+int main(void)
+{
+  it_wavelet_lifting_t const *liftings[2];
+  char const *names[2] = { "9/7", "5/3" };
+  int i, l, levels, failed = 0;
+  double error;
+
+  liftings[0] = it_wavelet_lifting_97;
+  liftings[1] = it_wavelet_lifting_53;
+
+  for(l = 0; l < 2; l++)
+    for(i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++)
+      for(levels = 1; levels <= 6; levels++) {
+	error = stream_error(liftings[l], sizes[i][0], sizes[i][1], levels);
+	printf("%s %dx%d, %d levels: error %g%s\n", names[l],
+	       sizes[i][0], sizes[i][1], levels, error,
+	       error == 0 ? "" : "  FAILED");
+	if(error != 0) failed++;
+      }
+
+  return(failed != 0);
+}